@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+//
+// Replays request traces against ClockHashMap and LruHashMap and prints hit
+// ratio and throughput as JSON:
+//
+//   cache_bench [--universe=N] [--requests=N] [--capacities=0.01,0.1]
+//
+// Each request is a get(); a miss inserts the key, evicting if the cache
+// is full. Capacities are fractions of the universe of hot keys.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "clock_hash_map.h"
+#include "lru_hash_map.h"
+#include "workload.h"
+
+namespace {
+
+using bench::Trace;
+
+struct Options {
+  size_t universe = 100000;
+  size_t requests = 2000000;
+  std::vector<double> capacities = {0.01, 0.05, 0.2};
+};
+
+template <class Cache>
+void Replay(bench::JsonReport *report, const char *cache_name,
+            const char *trace_name, const std::vector<uint64_t> &requests,
+            size_t capacity) {
+  Cache cache(capacity);
+  uint64_t hits = 0;
+  double nanoseconds = bench::TimeNanoseconds([&] {
+    for (uint64_t key : requests) {
+      if (cache.get(key) != nullptr) {
+        ++hits;
+      } else {
+        cache.insert({key, key});
+      }
+    }
+  });
+  bench::sink = hits;
+  report->Begin()
+      .Field("cache", cache_name)
+      .Field("trace", trace_name)
+      .Field("capacity", capacity)
+      .Field("requests", requests.size())
+      .Field("hit_ratio", static_cast<double>(hits) / requests.size())
+      .Field("ns_per_op", nanoseconds / requests.size())
+      .End();
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--universe=", 0) == 0) {
+      options.universe = static_cast<size_t>(std::stod(arg.substr(11)));
+    } else if (arg.rfind("--requests=", 0) == 0) {
+      options.requests = static_cast<size_t>(std::stod(arg.substr(11)));
+    } else if (arg.rfind("--capacities=", 0) == 0) {
+      options.capacities = bench::ParseList(arg.substr(13));
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--universe=N] [--requests=N] "
+                   "[--capacities=F,...]\n",
+                   argv[0]);
+      std::exit(2);
+    }
+  }
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options = ParseOptions(argc, argv);
+  bench::JsonReport report("cache");
+  for (Trace trace : {Trace::kZipfian, Trace::kScan}) {
+    std::vector<uint64_t> requests =
+        bench::MakeTrace(trace, options.universe, options.requests, 1);
+    for (double fraction : options.capacities) {
+      auto capacity =
+          std::max<size_t>(1, static_cast<size_t>(fraction *
+                                                  options.universe));
+      Replay<ClockHashMap<uint64_t, uint64_t>>(
+          &report, "ClockHashMap", bench::TraceName(trace), requests,
+          capacity);
+      Replay<LruHashMap<uint64_t, uint64_t>>(&report, "LruHashMap",
+                                             bench::TraceName(trace),
+                                             requests, capacity);
+    }
+  }
+  report.Print();
+  return 0;
+}
@@ -0,0 +1,335 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+//
+// Times HashMap against std::unordered_map, CuckooHashMap and
+// HopscotchHashMap and prints the results as JSON:
+//
+//   hash_map_bench [--mode=time|memory] [--sizes=1e3,1e6,1e8] [--lookups=N]
+//
+// In time mode, for every container, key type and size it times inserting
+// the keys, hit lookups under uniform and Zipfian key choice, miss lookups,
+// operator[] upserts, iteration, copying, rehashing to twice the entries
+// and erasing every key. Times are per operation; iteration and copy are
+// per entry.
+//
+// Memory mode inserts up to the largest size and reports the heap bytes
+// per entry each time the load factor of a table first reaches 0.1, 0.2,
+// ..., 0.9. The bytes are what the allocator handed out, counted by the
+// operator new below with malloc_usable_size(), so allocator rounding is
+// included; it needs glibc.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define HASH_MAP_BENCH_MEMORY 1
+#endif
+
+#include "cuckoo_hash_map.h"
+#include "hash_map.h"
+#include "hopscotch_hash_map.h"
+#include "workload.h"
+
+namespace {
+
+size_t live_bytes = 0;  // the benchmark is single-threaded
+
+}  // namespace
+
+#ifdef HASH_MAP_BENCH_MEMORY
+void *operator new(size_t size) {
+  void *ptr = std::malloc(size != 0 ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  live_bytes += malloc_usable_size(ptr);
+  return ptr;
+}
+
+void *operator new(size_t size, std::align_val_t align) {
+  auto alignment = static_cast<size_t>(align);
+  void *ptr = std::aligned_alloc(
+      alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment *
+                     alignment);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  live_bytes += malloc_usable_size(ptr);
+  return ptr;
+}
+
+// GCC pairs the new-expressions it inlines this into with the free() call
+// and warns; the blocks do come from malloc() above.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *ptr) noexcept {
+  if (ptr != nullptr) {
+    live_bytes -= malloc_usable_size(ptr);
+    std::free(ptr);
+  }
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void *ptr, size_t) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  operator delete(ptr);
+}
+#endif
+
+namespace {
+
+using bench::Distribution;
+
+// A value the size of a few cache lines, for keys whose entries are large.
+struct LargeValue {
+  std::array<uint64_t, 32> words = {};
+};
+
+uint64_t Touch(uint64_t value) {
+  return value;
+}
+
+uint64_t Touch(const LargeValue &value) {
+  return value.words[0];
+}
+
+void Bump(uint64_t *value) {
+  ++*value;
+}
+
+void Bump(LargeValue *value) {
+  ++value->words[0];
+}
+
+struct Options {
+  bool memory = false;
+  std::vector<size_t> sizes = {1000, 100000, 1000000};
+  size_t lookups = 1000000;
+};
+
+void Record(bench::JsonReport *report, const char *container,
+            const char *key_name, const char *operation,
+            const char *distribution, size_t size, size_t operations,
+            double nanoseconds) {
+  report->Begin()
+      .Field("container", container)
+      .Field("key", key_name)
+      .Field("operation", operation)
+      .Field("distribution", distribution)
+      .Field("size", size)
+      .Field("operations", operations)
+      .Field("ns_per_op", nanoseconds / std::max<size_t>(operations, 1))
+      .End();
+}
+
+template <class Map, class KeyType, class ValueType>
+void RunMap(bench::JsonReport *report, const char *container,
+            const char *key_name, size_t size, size_t lookups) {
+  std::vector<KeyType> keys(size);
+  for (size_t i = 0; i < size; ++i) {
+    keys[i] = bench::MakeKey<KeyType>(i);
+  }
+  std::vector<KeyType> missing(std::min(size, lookups));
+  for (size_t i = 0; i < missing.size(); ++i) {
+    missing[i] = bench::MakeKey<KeyType>(size + i);
+  }
+  auto record = [&](const char *operation, const char *distribution,
+                    size_t operations, double nanoseconds) {
+    Record(report, container, key_name, operation, distribution, size,
+                operations, nanoseconds);
+  };
+
+  Map map;
+  record("insert", "sequential", size, bench::TimeNanoseconds([&] {
+           for (const KeyType &key : keys) {
+             map.insert({key, ValueType()});
+           }
+         }));
+
+  for (Distribution distribution :
+       {Distribution::kUniform, Distribution::kZipfian}) {
+    std::vector<size_t> indices =
+        bench::MakeIndices(distribution, size, lookups, 1);
+    uint64_t hits = 0;
+    record("find_hit", bench::DistributionName(distribution), lookups,
+           bench::TimeNanoseconds([&] {
+             for (size_t index : indices) {
+               hits += map.find(keys[index]) != map.end();
+             }
+           }));
+    bench::sink = hits;
+
+    // Half of the keys drawn are not in the map yet.
+    std::vector<size_t> upserts =
+        bench::MakeIndices(distribution, 2 * size, lookups, 2);
+    std::vector<KeyType> upsert_keys(upserts.size());
+    for (size_t i = 0; i < upserts.size(); ++i) {
+      upsert_keys[i] = upserts[i] < size
+                           ? keys[upserts[i]]
+                           : bench::MakeKey<KeyType>(upserts[i]);
+    }
+    Map copy = map;
+    record("upsert", bench::DistributionName(distribution), lookups,
+           bench::TimeNanoseconds([&] {
+             for (const KeyType &key : upsert_keys) {
+               Bump(&copy[key]);
+             }
+           }));
+  }
+
+  uint64_t misses = 0;
+  size_t miss_lookups = std::max(lookups, missing.size());
+  record("find_miss", "uniform", miss_lookups, bench::TimeNanoseconds([&] {
+           for (size_t i = 0; i < miss_lookups; ++i) {
+             misses += map.find(missing[i % missing.size()]) == map.end();
+           }
+         }));
+  bench::sink = misses;
+
+  uint64_t sum = 0;
+  record("iterate", "sequential", size, bench::TimeNanoseconds([&] {
+           for (const auto &entry : map) {
+             sum += Touch(entry.second);
+           }
+         }));
+  bench::sink = sum;
+
+  Map copy;
+  record("copy", "sequential", size,
+         bench::TimeNanoseconds([&] { copy = map; }));
+
+  record("rehash", "sequential", size,
+         bench::TimeNanoseconds([&] { copy.reserve(2 * size); }));
+
+  record("erase", "sequential", size, bench::TimeNanoseconds([&] {
+           for (const KeyType &key : keys) {
+             map.erase(key);
+           }
+         }));
+}
+
+// Tables smaller than this are skipped; their fixed overheads dominate.
+constexpr size_t kMinMemoryEntries = 1024;
+
+template <class Map, class KeyType, class ValueType>
+void MeasureMap(bench::JsonReport *report, const char *container,
+                const char *key_name, size_t max_size) {
+  size_t base = live_bytes;
+  Map map;
+  size_t buckets = map.bucket_count();
+  size_t next_tenth = 1;
+  for (size_t i = 0; i < max_size; ++i) {
+    map.insert({bench::MakeKey<KeyType>(i), ValueType()});
+    if (map.bucket_count() != buckets) {
+      buckets = map.bucket_count();
+      next_tenth = 1;
+    }
+    double load_factor = map.load_factor();
+    if (next_tenth > 9 || load_factor < next_tenth / 10.0) {
+      continue;
+    }
+    while (next_tenth <= 9 && load_factor >= next_tenth / 10.0) {
+      ++next_tenth;
+    }
+    if (map.size() < std::min(kMinMemoryEntries, max_size)) {
+      continue;
+    }
+    size_t bytes = sizeof(map) + live_bytes - base;
+    report->Begin()
+        .Field("container", container)
+        .Field("key", key_name)
+        .Field("size", map.size())
+        .Field("bucket_count", buckets)
+        .Field("load_factor", load_factor)
+        .Field("bytes", bytes)
+        .Field("bytes_per_entry", static_cast<double>(bytes) / map.size())
+        .End();
+  }
+}
+
+template <class KeyType, class ValueType>
+void RunKey(bench::JsonReport *report, const Options &options,
+            const char *key_name, size_t size) {
+  if (options.memory) {
+    MeasureMap<HashMap<KeyType, ValueType>, KeyType, ValueType>(
+        report, "HashMap", key_name, size);
+    MeasureMap<std::unordered_map<KeyType, ValueType>, KeyType, ValueType>(
+        report, "std::unordered_map", key_name, size);
+    MeasureMap<CuckooHashMap<KeyType, ValueType>, KeyType, ValueType>(
+        report, "CuckooHashMap", key_name, size);
+    MeasureMap<HopscotchHashMap<KeyType, ValueType>, KeyType, ValueType>(
+        report, "HopscotchHashMap", key_name, size);
+    return;
+  }
+  RunMap<HashMap<KeyType, ValueType>, KeyType, ValueType>(
+      report, "HashMap", key_name, size, options.lookups);
+  RunMap<std::unordered_map<KeyType, ValueType>, KeyType, ValueType>(
+      report, "std::unordered_map", key_name, size, options.lookups);
+  RunMap<CuckooHashMap<KeyType, ValueType>, KeyType, ValueType>(
+      report, "CuckooHashMap", key_name, size, options.lookups);
+  RunMap<HopscotchHashMap<KeyType, ValueType>, KeyType, ValueType>(
+      report, "HopscotchHashMap", key_name, size, options.lookups);
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--mode=time" || arg == "--mode=memory") {
+      options.memory = arg == "--mode=memory";
+    } else if (arg.rfind("--sizes=", 0) == 0) {
+      options.sizes = bench::ParseSizes(arg.substr(8));
+    } else if (arg.rfind("--lookups=", 0) == 0) {
+      options.lookups = static_cast<size_t>(std::stod(arg.substr(10)));
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--mode=time|memory] [--sizes=N,...] "
+                   "[--lookups=N]\n",
+                   argv[0]);
+      std::exit(2);
+    }
+  }
+#ifndef HASH_MAP_BENCH_MEMORY
+  if (options.memory) {
+    std::fprintf(stderr, "memory mode needs glibc's malloc_usable_size\n");
+    std::exit(2);
+  }
+#endif
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options = ParseOptions(argc, argv);
+  bench::JsonReport report(options.memory ? "hash_map_memory" : "hash_map");
+  std::vector<size_t> sizes = options.sizes;
+  if (options.memory) {
+    sizes = {*std::max_element(sizes.begin(), sizes.end())};
+  }
+  for (size_t size : sizes) {
+    RunKey<uint64_t, uint64_t>(&report, options, "int", size);
+    RunKey<std::string, uint64_t>(&report, options, "string", size);
+    RunKey<uint64_t, LargeValue>(&report, options, "int_large_value", size);
+  }
+  report.Print();
+  return 0;
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hash_functions.h"
+
+// Key streams and reporting shared by the benchmarks.
+namespace bench {
+
+enum class Distribution { kUniform, kZipfian };
+
+inline const char *DistributionName(Distribution distribution) {
+  return distribution == Distribution::kUniform ? "uniform" : "zipfian";
+}
+
+// Zipfian ranks over [0, n), rank 0 the most frequent, after Gray et al.,
+// "Quickly generating billion-record synthetic databases" (as in YCSB).
+// Setup is O(n); drawing a rank is O(1).
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(size_t n, double theta, uint64_t seed);
+
+  size_t operator()();
+
+ private:
+  size_t n_;
+  double theta_;
+  double alpha_;
+  double zeta_n_;
+  double eta_;
+  std::mt19937_64 random_;
+  std::uniform_real_distribution<double> unit_;
+};
+
+inline ZipfianGenerator::ZipfianGenerator(size_t n, double theta,
+                                          uint64_t seed)
+    : n_(n), theta_(theta), alpha_(1 / (1 - theta)), random_(seed) {
+  zeta_n_ = 0;
+  for (size_t i = 1; i <= n; ++i) {
+    zeta_n_ += 1 / std::pow(static_cast<double>(i), theta);
+  }
+  double zeta_2 = 1 + 1 / std::pow(2.0, theta);
+  eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta_2 / zeta_n_);
+}
+
+inline size_t ZipfianGenerator::operator()() {
+  double u = unit_(random_);
+  double uz = u * zeta_n_;
+  if (uz < 1) {
+    return 0;
+  }
+  if (uz < 1 + std::pow(0.5, theta_)) {
+    return n_ > 1 ? 1 : 0;
+  }
+  auto rank =
+      static_cast<size_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+  return rank < n_ ? rank : n_ - 1;
+}
+
+// `count` indices into [0, n). Zipfian ranks are scattered over the range
+// by a bijective mix, so the hot keys are not the first ones inserted.
+inline std::vector<size_t> MakeIndices(Distribution distribution, size_t n,
+                                       size_t count, uint64_t seed) {
+  std::vector<size_t> indices(count);
+  if (distribution == Distribution::kUniform) {
+    std::mt19937_64 random(seed);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    for (size_t &index : indices) {
+      index = pick(random);
+    }
+  } else {
+    ZipfianGenerator zipf(n, 0.99, seed);
+    for (size_t &index : indices) {
+      index = MixBits(zipf()) % n;
+    }
+  }
+  return indices;
+}
+
+enum class Trace { kZipfian, kScan };
+
+inline const char *TraceName(Trace trace) {
+  return trace == Trace::kZipfian ? "zipfian" : "scan";
+}
+
+// A cache request trace of `length` key numbers. kZipfian draws from
+// [0, universe) by the scattered Zipfian above. kScan interleaves that with
+// sequential scans: the first scan_length of every scan_period requests
+// walk consecutive keys of [universe, 2 * universe), each touched once per
+// pass, the pattern that flushes an LRU of its hot entries.
+inline std::vector<uint64_t> MakeTrace(Trace trace, size_t universe,
+                                       size_t length, uint64_t seed,
+                                       size_t scan_period = 4096,
+                                       size_t scan_length = 1024) {
+  std::vector<uint64_t> requests(length);
+  ZipfianGenerator zipf(universe, 0.99, seed);
+  size_t scan_next = 0;
+  for (size_t i = 0; i < length; ++i) {
+    if (trace == Trace::kScan && i % scan_period < scan_length) {
+      requests[i] = universe + scan_next;
+      scan_next = (scan_next + 1) % universe;
+    } else {
+      requests[i] = MixBits(zipf()) % universe;
+    }
+  }
+  return requests;
+}
+
+// Key number i as a key: distinct i give distinct keys, and the integers
+// are already mixed so that std::hash's identity is a fair baseline.
+template <class KeyType>
+KeyType MakeKey(uint64_t i);
+
+template <>
+inline uint64_t MakeKey<uint64_t>(uint64_t i) {
+  return MixBits(i);
+}
+
+// 16 hex digits: one past the libstdc++ SSO capacity, so keys live on the
+// heap as typical string keys do.
+template <>
+inline std::string MakeKey<std::string>(uint64_t i) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(MixBits(i)));
+  return buffer;
+}
+
+// Defeats dead-code elimination of benchmarked loops.
+inline volatile uint64_t sink;
+
+template <class Fn>
+double TimeNanoseconds(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Results as {"benchmark": name, "results": [record, ...]}; a record is a
+// flat object of string and number fields.
+class JsonReport {
+ public:
+  explicit JsonReport(std::string name) : name_(std::move(name)) {}
+
+  JsonReport &Begin() {
+    out_ << (records_++ == 0 ? "\n    {" : ",\n    {");
+    fields_ = 0;
+    return *this;
+  }
+
+  JsonReport &Field(const char *key, const std::string &value) {
+    Key(key) << '"' << value << '"';
+    return *this;
+  }
+
+  JsonReport &Field(const char *key, size_t value) {
+    Key(key) << value;
+    return *this;
+  }
+
+  JsonReport &Field(const char *key, double value) {
+    Key(key) << value;
+    return *this;
+  }
+
+  JsonReport &End() {
+    out_ << "}";
+    return *this;
+  }
+
+  void Print() const {
+    std::printf("{\n  \"benchmark\": \"%s\",\n  \"results\": [%s\n  ]\n}\n",
+                name_.c_str(), out_.str().c_str());
+  }
+
+ private:
+  std::ostream &Key(const char *key) {
+    return out_ << (fields_++ == 0 ? "" : ", ") << '"' << key << "\": ";
+  }
+
+  std::string name_;
+  std::ostringstream out_;
+  size_t records_ = 0;
+  size_t fields_ = 0;
+};
+
+// Parses the value of a "--name=1,2.5,1e6" option.
+inline std::vector<double> ParseList(const std::string &list) {
+  std::vector<double> values;
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    values.push_back(std::stod(item));
+  }
+  return values;
+}
+
+inline std::vector<size_t> ParseSizes(const std::string &list) {
+  std::vector<size_t> sizes;
+  for (double value : ParseList(list)) {
+    sizes.push_back(static_cast<size_t>(value));
+  }
+  return sizes;
+}
+
+}  // namespace bench
@@ -0,0 +1,202 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "hash_map.h"
+
+// Bounded cache with CLOCK eviction. A hit only sets the entry's reference
+// bit, unlike LruHashMap which splices the list on every hit. On a miss in
+// a full cache the hand sweeps the entries in a circle, clearing reference
+// bits, and evicts the first entry found unreferenced. A new entry takes the
+// victim's place just behind the hand, so the hand passes every other entry
+// before coming back to it.
+//
+// Not thread-safe: get() writes the reference bit.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class ClockHashMap {
+  struct Slot {
+    ValueType value;
+    bool referenced;
+  };
+
+  using Map = HashMap<KeyType, Slot, Hash, KeyEqual>;
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+ public:
+  using EvictionCallback = std::function<void(const KeyType &, ValueType &)>;
+
+  explicit ClockHashMap(size_t capacity,
+                        EvictionCallback on_evict = EvictionCallback(),
+                        const Hash &hash = RandomlySeededHash<Hash>(),
+                        const KeyEqual &equal = KeyEqual());
+
+  ClockHashMap(const ClockHashMap &other) = delete;
+
+  ClockHashMap &operator=(const ClockHashMap &other) = delete;
+
+  // Returns nullptr on a miss; a hit sets the reference bit.
+  ValueType *get(const KeyType &key);
+
+  // Lookup without setting the reference bit.
+  const ValueType *peek(const KeyType &key) const;
+
+  bool contains(const KeyType &key) const {
+    return map_.find(key) != map_.end();
+  }
+
+  // An existing key is only marked as referenced; otherwise an entry is
+  // evicted first if the cache is full.
+  void insert(const ConstKeyValuePair &elem);
+
+  ValueType &operator[](const KeyType &key);
+
+  void erase(const KeyType &key);
+
+  bool empty() const {
+    return map_.empty();
+  }
+
+  size_t size() const {
+    return map_.size();
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  void clear() {
+    map_.clear();
+    hand_ = map_.end();
+  }
+
+ private:
+  using MapIterator = typename Map::iterator;
+
+  // The hand moves towards the front of the map's list and wraps around to
+  // the back.
+  void AdvanceHand() {
+    if (hand_ == map_.begin()) {
+      hand_ = map_.end();
+    }
+    --hand_;
+  }
+
+  void EvictIfFull();
+
+  // Inserts an absent key just behind the hand, evicting first if full.
+  MapIterator InsertNew(const KeyType &key, const ValueType &value);
+
+  Map map_;
+  MapIterator hand_;  // map_.end() until the first eviction
+  size_t capacity_;
+  EvictionCallback on_evict_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::ClockHashMap(
+    size_t capacity, EvictionCallback on_evict, const Hash &hash,
+    const KeyEqual &equal)
+    : map_(hash, equal),
+      hand_(map_.end()),
+      capacity_(capacity),
+      on_evict_(std::move(on_evict)) {
+  if (capacity_ == 0) {
+    throw std::invalid_argument("ClockHashMap capacity must be positive");
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType *ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::get(
+    const KeyType &key) {
+  MapIterator it = map_.find(key);
+  if (it == map_.end()) {
+    return nullptr;
+  }
+  // Repeated hits leave the entry's cache line clean.
+  if (!it->second.referenced) {
+    it->second.referenced = true;
+  }
+  return &it->second.value;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+const ValueType *ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::peek(
+    const KeyType &key) const {
+  auto it = map_.find(key);
+  return it != map_.end() ? &it->second.value : nullptr;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::insert(
+    const ConstKeyValuePair &elem) {
+  if (get(elem.first) == nullptr) {
+    InsertNew(elem.first, elem.second);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType &ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::operator[](
+    const KeyType &key) {
+  ValueType *value = get(key);
+  if (value != nullptr) {
+    return *value;
+  }
+  return InsertNew(key, ValueType{})->second.value;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::erase(
+    const KeyType &key) {
+  MapIterator it = map_.find(key);
+  if (it == map_.end()) {
+    return;
+  }
+  if (it == hand_) {
+    AdvanceHand();
+    if (hand_ == it) {
+      hand_ = map_.end();
+    }
+  }
+  map_.erase(it);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::EvictIfFull() {
+  if (map_.size() < capacity_) {
+    return;
+  }
+  if (hand_ == map_.end()) {
+    hand_ = std::prev(map_.end());
+  }
+  while (hand_->second.referenced) {
+    hand_->second.referenced = false;
+    AdvanceHand();
+  }
+  MapIterator victim = hand_;
+  AdvanceHand();
+  if (hand_ == victim) {
+    hand_ = map_.end();
+  }
+  if (on_evict_) {
+    on_evict_(victim->first, victim->second.value);
+  }
+  map_.erase(victim);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto ClockHashMap<KeyType, ValueType, Hash, KeyEqual>::InsertNew(
+    const KeyType &key, const ValueType &value) -> MapIterator {
+  EvictIfFull();
+  map_.insert({key, Slot{value, false}});
+  MapIterator entry = map_.begin();
+  if (hand_ != map_.end()) {
+    map_.move_before(entry, std::next(hand_));
+  }
+  return entry;
+}
@@ -0,0 +1,1067 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash_functions.h"
+
+namespace concurrent_internal {
+
+// ThreadSanitizer does not model the fences of the lock-free reads, and
+// writers store entries with plain writes that those reads overlap, so
+// under it every read takes the bucket locks and the fences are left out.
+#if defined(__SANITIZE_THREAD__)
+constexpr bool kThreadSanitizer = true;
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+constexpr bool kThreadSanitizer = true;
+#else
+constexpr bool kThreadSanitizer = false;
+#endif
+#else
+constexpr bool kThreadSanitizer = false;
+#endif
+
+// Tells the CPU that the caller is spinning.
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// A spinlock whose version is odd while it is held, so that a reader can
+// tell whether anything was written under it without taking it. Stripes sit
+// in separate cache lines.
+struct alignas(64) Stripe {
+  void Lock() {
+    uint64_t current = version.load(std::memory_order_relaxed);
+    while ((current & 1) != 0 ||
+           !version.compare_exchange_weak(current, current + 1,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+      CpuRelax();
+      current = version.load(std::memory_order_relaxed);
+    }
+    // Keeps the writes below from becoming visible before the odd version.
+    if constexpr (!kThreadSanitizer) {
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+  }
+
+  void Unlock() {
+    version.fetch_add(1, std::memory_order_release);
+  }
+
+  std::atomic<uint64_t> version{0};
+  std::atomic<ptrdiff_t> count{0};  // entries added minus removed under it
+};
+
+class StripeGuard {
+ public:
+  explicit StripeGuard(Stripe *stripe) : stripe_(stripe) {
+    stripe_->Lock();
+  }
+
+  StripeGuard(const StripeGuard &other) = delete;
+  StripeGuard &operator=(const StripeGuard &other) = delete;
+
+  ~StripeGuard() {
+    stripe_->Unlock();
+  }
+
+ private:
+  Stripe *stripe_;
+};
+
+// Locks two stripes of one array, lower address first; they may coincide.
+class StripePairGuard {
+ public:
+  StripePairGuard(Stripe *first, Stripe *second)
+      : lower_(std::min(first, second)),
+        upper_(first != second ? std::max(first, second) : nullptr) {
+    lower_->Lock();
+    if (upper_ != nullptr) {
+      upper_->Lock();
+    }
+  }
+
+  StripePairGuard(const StripePairGuard &other) = delete;
+  StripePairGuard &operator=(const StripePairGuard &other) = delete;
+
+  ~StripePairGuard() {
+    if (upper_ != nullptr) {
+      upper_->Unlock();
+    }
+    lower_->Unlock();
+  }
+
+ private:
+  Stripe *lower_;
+  Stripe *upper_;
+};
+
+// Locks `count` consecutive stripes in order.
+class StripeRangeGuard {
+ public:
+  StripeRangeGuard(Stripe *stripes, size_t count)
+      : stripes_(stripes), count_(count) {
+    for (size_t i = 0; i < count_; ++i) {
+      stripes_[i].Lock();
+    }
+  }
+
+  StripeRangeGuard(const StripeRangeGuard &other) = delete;
+  StripeRangeGuard &operator=(const StripeRangeGuard &other) = delete;
+
+  ~StripeRangeGuard() {
+    for (size_t i = count_; i > 0; --i) {
+      stripes_[i - 1].Unlock();
+    }
+  }
+
+ private:
+  Stripe *stripes_;
+  size_t count_;
+};
+
+// Stripe versions seen by a lock-free read; the read is good only if none
+// of them changes before it ends.
+class StripeSnapshot {
+ public:
+  // False if the stripe is locked.
+  bool Add(const Stripe &stripe) {
+    uint64_t version = stripe.version.load(std::memory_order_acquire);
+    if ((version & 1) != 0) {
+      return false;
+    }
+    stripes_[count_] = &stripe;
+    versions_[count_] = version;
+    ++count_;
+    return true;
+  }
+
+  bool Validate() const {
+    if constexpr (!kThreadSanitizer) {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    for (size_t i = 0; i < count_; ++i) {
+      if (stripes_[i]->version.load(std::memory_order_relaxed) !=
+          versions_[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::array<const Stripe *, 3> stripes_ = {};
+  std::array<uint64_t, 3> versions_ = {};
+  size_t count_ = 0;
+};
+
+// Copies an object a writer may be changing, a word at a time through
+// relaxed atomic loads. The copy may be torn and is only used once a
+// StripeSnapshot validates.
+template <class T>
+T RacyCopy(const T &from) {
+  using Word = std::conditional_t<
+      alignof(T) % sizeof(uint64_t) == 0, uint64_t,
+      std::conditional_t<alignof(T) % sizeof(uint32_t) == 0, uint32_t,
+                         unsigned char>>;
+  std::aligned_storage_t<sizeof(T), alignof(T)> copy;
+  const auto *source = reinterpret_cast<const Word *>(&from);
+  auto *target = reinterpret_cast<Word *>(&copy);
+  for (size_t i = 0; i < sizeof(T) / sizeof(Word); ++i) {
+    target[i] = __atomic_load_n(source + i, __ATOMIC_RELAXED);
+  }
+  return *std::launder(reinterpret_cast<T *>(&copy));
+}
+
+}  // namespace concurrent_internal
+
+// Cuckoo hash table for many threads inserting, updating and looking up at
+// once. The layout follows CuckooHashMap's: two candidate buckets per key
+// derived from an 8-bit tag, and a stash, but buckets always have 4 slots.
+//
+// Bucket i is guarded by the spinlock stripe i % kStripes. A write locks
+// the stripes of its key's two buckets, so writes to other buckets run in
+// parallel. Displacement paths are searched without locks and walked one
+// move at a time, each move locking only the two buckets it touches.
+// Growing locks every stripe.
+//
+// When keys and values are trivially copyable, find() takes no lock: it
+// copies the entry and retries if a stripe version changed meanwhile, as
+// with a seqlock. Other types are read under the bucket locks.
+//
+// There are no iterators: find() copies the value out, and upsert() runs a
+// function on it under the bucket locks. The function must not call into
+// the map. Tables replaced by growth are freed with the map so that
+// lock-free readers never touch freed memory; together they are smaller
+// than the current table.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class ConcurrentCuckooHashMap {
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+  using Stripe = concurrent_internal::Stripe;
+
+  static constexpr size_t kSlots = 4;
+  static constexpr size_t kStripes = 1024;  // a power of two
+  static constexpr size_t kMaxSearch = 256;  // BFS nodes per displacement
+  static constexpr size_t kNoParent = std::numeric_limits<size_t>::max();
+  static constexpr bool kOptimisticReads =
+      std::is_trivially_copyable<KeyType>::value &&
+      std::is_trivially_copyable<ValueType>::value &&
+      !concurrent_internal::kThreadSanitizer;
+
+  using SlotStorage = std::aligned_storage_t<sizeof(ConstKeyValuePair),
+                                             alignof(ConstKeyValuePair)>;
+
+  struct Bucket {
+    Bucket() = default;
+    Bucket(const Bucket &other) = delete;
+    Bucket &operator=(const Bucket &other) = delete;
+
+    ~Bucket() {
+      for (size_t i = 0; i < kSlots; ++i) {
+        if (tags[i].load(std::memory_order_relaxed) != 0) {
+          std::destroy_at(&slot(i));
+        }
+      }
+    }
+
+    ConstKeyValuePair &slot(size_t i) {
+      return *std::launder(reinterpret_cast<ConstKeyValuePair *>(&storage[i]));
+    }
+
+    const ConstKeyValuePair &slot(size_t i) const {
+      return *std::launder(
+          reinterpret_cast<const ConstKeyValuePair *>(&storage[i]));
+    }
+
+    std::atomic<uint8_t> tags[kSlots] = {};  // 0 marks a free slot
+    SlotStorage storage[kSlots];
+  };
+
+  // A bucket reached by the displacement search: the entry in `slot` of the
+  // parent's bucket would move here.
+  struct PathNode {
+    size_t bucket;
+    size_t parent;
+    size_t slot;
+  };
+
+  // The entry in `slot` of nodes[node].bucket can move to the free bucket
+  // `to`, and so on up to a root.
+  struct Path {
+    std::array<PathNode, kMaxSearch> nodes;
+    size_t node;
+    size_t slot;
+    size_t to;
+  };
+
+  // The function giving the value of a new entry; Table::Store calls it
+  // only when the entry is constructed.
+  template <class Init>
+  struct InitWith {
+    Init &init;
+  };
+
+  // Selects the upsert() overload taking a function for the initial value.
+  template <class Init>
+  using IfInitFunction =
+      std::enable_if_t<std::is_invocable_r<ValueType, Init &>::value, bool>;
+
+  // Buckets followed by the stash. Tags are read without locks; everything
+  // else is written under the stripes of the buckets involved.
+  struct Table {
+    Table(size_t bucket_count, size_t stash_buckets)
+        : buckets(bucket_count + stash_buckets),
+          mask(bucket_count - 1),
+          stash_index(bucket_count) {}
+
+    size_t bucket_count() const {
+      return stash_index;
+    }
+
+    size_t stash_buckets() const {
+      return buckets.size() - stash_index;
+    }
+
+    size_t AltIndex(size_t index, uint8_t tag) const {
+      return (index ^ ((tag + size_t{1}) * 0x5bd1e995)) & mask;
+    }
+
+    bool FreeSlot(size_t index, size_t *slot) const {
+      for (size_t i = 0; i < kSlots; ++i) {
+        if (buckets[index].tags[i].load(std::memory_order_relaxed) == 0) {
+          *slot = i;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool FreeSlotIn(size_t first, size_t second, size_t *index,
+                    size_t *slot) const {
+      if (FreeSlot(first, slot)) {
+        *index = first;
+        return true;
+      }
+      *index = second;
+      return FreeSlot(second, slot);
+    }
+
+    bool FreeStashSlot(size_t *index, size_t *slot) const {
+      for (*index = stash_index; *index < buckets.size(); ++*index) {
+        if (FreeSlot(*index, slot)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    template <class... Args>
+    void Store(size_t index, size_t slot, uint8_t tag, Args &&... args) {
+      Bucket &bucket = buckets[index];
+      new (&bucket.storage[slot])
+          ConstKeyValuePair(std::forward<Args>(args)...);
+      bucket.tags[slot].store(tag, std::memory_order_relaxed);
+    }
+
+    template <class Init>
+    void Store(size_t index, size_t slot, uint8_t tag, const KeyType &key,
+               InitWith<Init> init) {
+      Store(index, slot, tag, key, init.init());
+    }
+
+    void Destroy(size_t index, size_t slot) {
+      std::destroy_at(&buckets[index].slot(slot));
+      buckets[index].tags[slot].store(0, std::memory_order_relaxed);
+    }
+
+    // Moves the entry in `slot` of bucket `from` to its other bucket `to`.
+    // False if that is no longer possible.
+    bool Move(size_t from, size_t slot, size_t to);
+
+    // Breadth-first search for moves that free a slot in `first` or
+    // `second`. Without locks the path may be stale when it is walked.
+    bool FindPath(size_t first, size_t second, Path *path) const;
+
+    std::vector<Bucket> buckets;
+    size_t mask;
+    size_t stash_index;
+    std::atomic<size_t> stash_size{0};
+  };
+
+  enum class ReadResult { kFound, kMissing, kRetry };
+
+ public:
+  ConcurrentCuckooHashMap(const Hash &hash = RandomlySeededHash<Hash>(),
+                          const KeyEqual &equal = KeyEqual());
+
+  template <class ContainerIterator>
+  ConcurrentCuckooHashMap(ContainerIterator begin, ContainerIterator end,
+                          const Hash &hash = RandomlySeededHash<Hash>(),
+                          const KeyEqual &equal = KeyEqual());
+
+  ConcurrentCuckooHashMap(std::initializer_list<ConstKeyValuePair> initial,
+                          const Hash &hash = RandomlySeededHash<Hash>(),
+                          const KeyEqual &equal = KeyEqual());
+
+  ConcurrentCuckooHashMap(const ConcurrentCuckooHashMap &other) = delete;
+  ConcurrentCuckooHashMap &operator=(const ConcurrentCuckooHashMap &other) =
+      delete;
+
+  ~ConcurrentCuckooHashMap() = default;
+
+  // Copies the value of `key` to *value, unless value is null; false if the
+  // key is absent.
+  bool find(const KeyType &key, ValueType *value) const;
+
+  bool contains(const KeyType &key) const {
+    return find(key, nullptr);
+  }
+
+  ValueType at(const KeyType &key) const;
+
+  // Returns false, leaving the map as it is, if the key is present.
+  bool insert(const ConstKeyValuePair &elem);
+
+  // Returns false if the key is absent.
+  bool erase(const KeyType &key);
+
+  // Calls fn(value) on the value of `key`, or inserts `key` with the value
+  // init() returns if it is absent, as one atomic step. init is called only
+  // then, under the bucket locks like fn. Returns true if it inserted.
+  template <class Fn, class Init>
+  IfInitFunction<Init> upsert(const KeyType &key, Fn fn, Init init);
+
+  template <class Fn>
+  bool upsert(const KeyType &key, Fn fn, const ValueType &init) {
+    return upsert(key, fn, [&init]() -> const ValueType & { return init; });
+  }
+
+  // Calls fn(value) on the value of `key`, value-initialized in place if the
+  // key is absent, as one atomic step. Returns true if it inserted.
+  template <class Fn>
+  bool compute(const KeyType &key, Fn fn);
+
+  // Exact only while no writer runs.
+  size_t size() const;
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  Hash hash_function() const {
+    return hasher_;
+  }
+
+  KeyEqual key_eq() const {
+    return key_equal_;
+  }
+
+  // Keeps the bucket array.
+  void clear();
+
+  // Sizes the table so that `count` entries fit without growing.
+  void reserve(size_t count);
+
+  // Buckets of kSlots entries, not counting the stash.
+  size_t bucket_count() const {
+    return table_.load(std::memory_order_acquire)->bucket_count();
+  }
+
+  // Entries that found no room in either of their buckets.
+  size_t stash_size() const {
+    return table_.load(std::memory_order_acquire)
+        ->stash_size.load(std::memory_order_relaxed);
+  }
+
+  double load_factor() const {
+    return static_cast<double>(size()) / (bucket_count() * kSlots);
+  }
+
+ private:
+  // reserve() plans for this load; inserts fill the table further.
+  static constexpr double kMaxLoadFactor = 0.9;
+  // Growing doubles the table only if its load stays above this.
+  static constexpr double kMinLoadFactor = 0.125;
+  const size_t initialBuckets_ = 2;
+
+  static uint8_t TagOf(size_t hash) {
+    auto tag = static_cast<uint8_t>(
+        hash >> (std::numeric_limits<size_t>::digits - 8));
+    return tag != 0 ? tag : 1;
+  }
+
+  // Walks `path` from its free end, stopping at the first failed move.
+  template <class MoveFn>
+  static bool WalkPath(const Path &path, MoveFn move);
+
+  Stripe &StripeOf(size_t index) const {
+    return stripes_[index & (kStripes - 1)];
+  }
+
+  Stripe &StashStripe() const {
+    return stripes_[kStripes];
+  }
+
+  bool ScanBucket(const Table &table, size_t index, uint8_t tag,
+                  const KeyType &key, size_t *slot) const;
+
+  bool Search(const Table &table, size_t first, size_t second, uint8_t tag,
+              const KeyType &key, size_t *index, size_t *slot) const;
+
+  bool SearchStash(const Table &table, uint8_t tag, const KeyType &key,
+                   size_t *index, size_t *slot) const;
+
+  // One lock-free attempt at find().
+  ReadResult TryFind(const KeyType &key, size_t hash, ValueType *value) const;
+
+  ReadResult ReadBucket(const Table &table, size_t index, uint8_t tag,
+                        const KeyType &key,
+                        const concurrent_internal::StripeSnapshot &snapshot,
+                        ValueType *value) const;
+
+  // Locks the buckets of `key` and calls fn(table, index, slot) on its
+  // entry; false if the key is absent.
+  template <class Fn>
+  bool Visit(const KeyType &key, size_t hash, Fn fn) const;
+
+  // Calls update(value) if `key` is present, otherwise constructs the entry
+  // from `args`, and updates that too if `update_new`. Returns true if it
+  // inserted.
+  template <class Update, class... Args>
+  bool Upsert(const KeyType &key, Update &&update, bool update_new,
+              Args &&... args);
+
+  bool MoveLocked(Table *table, size_t from, size_t slot, size_t to);
+
+  // Stores an entry in an unpublished table; false if even the stash is
+  // full.
+  template <class Entry>
+  bool Place(Table *table, Entry &&elem, size_t hash);
+
+  // Moves every entry out of the table.
+  std::vector<ConstKeyValuePair> TakeEntries(Table *table);
+
+  ptrdiff_t CountEntries() const;
+
+  // Grows after an insert into `seen` found no room, unless another thread
+  // already replaced it.
+  void Grow(const Table *seen);
+
+  // Replaces the table; the caller holds every stripe.
+  void Rebuild(size_t bucket_count, size_t stash_buckets);
+
+  // One stripe per kStripes buckets and a last one for the stash.
+  std::unique_ptr<Stripe[]> stripes_ =
+      std::make_unique<Stripe[]>(kStripes + 1);
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::atomic<Table *> table_{nullptr};
+  Hash hasher_;
+  KeyEqual key_equal_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Table::Move(
+    size_t from, size_t slot, size_t to) {
+  Bucket &source = buckets[from];
+  uint8_t tag = source.tags[slot].load(std::memory_order_relaxed);
+  size_t to_slot;
+  if (tag == 0 || AltIndex(from, tag) != to || !FreeSlot(to, &to_slot)) {
+    return false;
+  }
+  Store(to, to_slot, tag, std::move(source.slot(slot)));
+  Destroy(from, slot);
+  return true;
+}
+
+// Buckets already on a path are not revisited, so each move along the path
+// takes an entry that is still in the slot the search saw it in, unless
+// another thread changed the bucket.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Table::
+    FindPath(size_t first, size_t second, Path *path) const {
+  std::array<PathNode, kMaxSearch> &nodes = path->nodes;
+  size_t count = 0;
+  nodes[count++] = {first, kNoParent, 0};
+  if (second != first) {
+    nodes[count++] = {second, kNoParent, 0};
+  }
+  for (size_t head = 0; head < count; ++head) {
+    size_t bucket = nodes[head].bucket;
+    for (size_t i = 0; i < kSlots; ++i) {
+      uint8_t tag = buckets[bucket].tags[i].load(std::memory_order_relaxed);
+      if (tag == 0) {
+        continue;
+      }
+      size_t alt = AltIndex(bucket, tag);
+      size_t free_slot;
+      if (FreeSlot(alt, &free_slot)) {
+        path->node = head;
+        path->slot = i;
+        path->to = alt;
+        return true;
+      }
+      bool on_path = false;
+      for (size_t n = head; n != kNoParent && !on_path; n = nodes[n].parent) {
+        on_path = nodes[n].bucket == alt;
+      }
+      if (!on_path && count < kMaxSearch) {
+        nodes[count++] = {alt, head, i};
+      }
+    }
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::
+    ConcurrentCuckooHashMap(const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  tables_.push_back(std::make_unique<Table>(initialBuckets_, 1));
+  table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class ContainerIterator>
+ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::
+    ConcurrentCuckooHashMap(ContainerIterator begin, ContainerIterator end,
+                            const Hash &hash, const KeyEqual &equal)
+    : ConcurrentCuckooHashMap(hash, equal) {
+  for (auto element = begin; element != end; ++element) {
+    insert(*element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::
+    ConcurrentCuckooHashMap(std::initializer_list<ConstKeyValuePair> initial,
+                            const Hash &hash, const KeyEqual &equal)
+    : ConcurrentCuckooHashMap(hash, equal) {
+  for (const auto &element : initial) {
+    insert(element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::find(
+    const KeyType &key, ValueType *value) const {
+  size_t hash = hasher_(key);
+  if constexpr (kOptimisticReads) {
+    ReadResult result;
+    while ((result = TryFind(key, hash, value)) == ReadResult::kRetry) {
+      concurrent_internal::CpuRelax();
+    }
+    return result == ReadResult::kFound;
+  } else {
+    return Visit(key, hash, [value](Table &table, size_t index, size_t slot) {
+      if (value != nullptr) {
+        *value = table.buckets[index].slot(slot).second;
+      }
+    });
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::at(
+    const KeyType &key) const {
+  ValueType value;
+  if (find(key, &value)) {
+    return value;
+  }
+  throw std::out_of_range("Bad request");
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::insert(
+    const ConstKeyValuePair &elem) {
+  return Upsert(elem.first, [](ValueType &) {}, false, elem);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::erase(
+    const KeyType &key) {
+  size_t hash = hasher_(key);
+  return Visit(key, hash, [this, hash](Table &table, size_t index,
+                                       size_t slot) {
+    table.Destroy(index, slot);
+    if (index >= table.stash_index) {
+      table.stash_size.fetch_sub(1, std::memory_order_relaxed);
+    }
+    StripeOf(hash & table.mask).count.fetch_sub(1, std::memory_order_relaxed);
+  });
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Fn, class Init>
+auto ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::upsert(
+    const KeyType &key, Fn fn, Init init) -> IfInitFunction<Init> {
+  return Upsert(key, fn, false, key, InitWith<Init>{init});
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Fn>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::compute(
+    const KeyType &key, Fn fn) {
+  return Upsert(key, fn, true, std::piecewise_construct,
+                std::forward_as_tuple(key), std::forward_as_tuple());
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+size_t ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::size()
+    const {
+  ptrdiff_t count = CountEntries();
+  return count > 0 ? count : 0;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::clear() {
+  concurrent_internal::StripeRangeGuard guard(stripes_.get(), kStripes + 1);
+  Table *table = table_.load(std::memory_order_relaxed);
+  for (size_t index = 0; index < table->buckets.size(); ++index) {
+    for (size_t i = 0; i < kSlots; ++i) {
+      if (table->buckets[index].tags[i].load(std::memory_order_relaxed) !=
+          0) {
+        table->Destroy(index, i);
+      }
+    }
+  }
+  table->stash_size.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i <= kStripes; ++i) {
+    stripes_[i].count.store(0, std::memory_order_relaxed);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::reserve(
+    size_t count) {
+  concurrent_internal::StripeRangeGuard guard(stripes_.get(), kStripes + 1);
+  Table *table = table_.load(std::memory_order_relaxed);
+  size_t new_count = table->bucket_count();
+  while (count > new_count * kSlots * kMaxLoadFactor) {
+    new_count <<= 1;
+  }
+  if (new_count != table->bucket_count()) {
+    Rebuild(new_count, table->stash_buckets());
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class MoveFn>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::WalkPath(
+    const Path &path, MoveFn move) {
+  size_t node = path.node;
+  size_t slot = path.slot;
+  size_t to = path.to;
+  while (move(path.nodes[node].bucket, slot, to)) {
+    if (path.nodes[node].parent == kNoParent) {
+      return true;
+    }
+    to = path.nodes[node].bucket;
+    slot = path.nodes[node].slot;
+    node = path.nodes[node].parent;
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::ScanBucket(
+    const Table &table, size_t index, uint8_t tag, const KeyType &key,
+    size_t *slot) const {
+  const Bucket &bucket = table.buckets[index];
+  for (size_t i = 0; i < kSlots; ++i) {
+    if (bucket.tags[i].load(std::memory_order_relaxed) == tag &&
+        key_equal_(bucket.slot(i).first, key)) {
+      *slot = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Search(
+    const Table &table, size_t first, size_t second, uint8_t tag,
+    const KeyType &key, size_t *index, size_t *slot) const {
+  if (ScanBucket(table, first, tag, key, slot)) {
+    *index = first;
+    return true;
+  }
+  *index = second;
+  return ScanBucket(table, second, tag, key, slot);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::SearchStash(
+    const Table &table, uint8_t tag, const KeyType &key, size_t *index,
+    size_t *slot) const {
+  for (*index = table.stash_index; *index < table.buckets.size(); ++*index) {
+    if (ScanBucket(table, *index, tag, key, slot)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The table pointer is checked after the stripe versions are read: growth
+// holds every stripe, so it either finished before and replaced the table,
+// or it changes a version before the read ends.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::TryFind(
+    const KeyType &key, size_t hash, ValueType *value) const -> ReadResult {
+  const Table *table = table_.load(std::memory_order_acquire);
+  uint8_t tag = TagOf(hash);
+  size_t first = hash & table->mask;
+  size_t second = table->AltIndex(first, tag);
+  concurrent_internal::StripeSnapshot snapshot;
+  if (!snapshot.Add(StripeOf(first)) || !snapshot.Add(StripeOf(second)) ||
+      table_.load(std::memory_order_acquire) != table) {
+    return ReadResult::kRetry;
+  }
+  ReadResult result = ReadBucket(*table, first, tag, key, snapshot, value);
+  if (result == ReadResult::kMissing) {
+    result = ReadBucket(*table, second, tag, key, snapshot, value);
+  }
+  if (result == ReadResult::kMissing &&
+      table->stash_size.load(std::memory_order_acquire) != 0) {
+    if (!snapshot.Add(StashStripe())) {
+      return ReadResult::kRetry;
+    }
+    for (size_t index = table->stash_index;
+         index < table->buckets.size() && result == ReadResult::kMissing;
+         ++index) {
+      result = ReadBucket(*table, index, tag, key, snapshot, value);
+    }
+  }
+  if (result == ReadResult::kMissing && !snapshot.Validate()) {
+    return ReadResult::kRetry;
+  }
+  return result;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::ReadBucket(
+    const Table &table, size_t index, uint8_t tag, const KeyType &key,
+    const concurrent_internal::StripeSnapshot &snapshot,
+    ValueType *value) const -> ReadResult {
+  const Bucket &bucket = table.buckets[index];
+  for (size_t i = 0; i < kSlots; ++i) {
+    if (bucket.tags[i].load(std::memory_order_relaxed) != tag) {
+      continue;
+    }
+    KeyType candidate = concurrent_internal::RacyCopy(bucket.slot(i).first);
+    if (!snapshot.Validate()) {
+      return ReadResult::kRetry;
+    }
+    if (key_equal_(candidate, key)) {
+      if (value != nullptr) {
+        ValueType copy = concurrent_internal::RacyCopy(bucket.slot(i).second);
+        if (!snapshot.Validate()) {
+          return ReadResult::kRetry;
+        }
+        *value = copy;
+      }
+      return ReadResult::kFound;
+    }
+  }
+  return ReadResult::kMissing;
+}
+
+// A stashed key was stored under the stripes of its buckets, so holding
+// them makes its stash_size increment visible.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Fn>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Visit(
+    const KeyType &key, size_t hash, Fn fn) const {
+  uint8_t tag = TagOf(hash);
+  while (true) {
+    Table *table = table_.load(std::memory_order_acquire);
+    size_t first = hash & table->mask;
+    size_t second = table->AltIndex(first, tag);
+    concurrent_internal::StripePairGuard guard(&StripeOf(first),
+                                               &StripeOf(second));
+    if (table_.load(std::memory_order_acquire) != table) {
+      continue;
+    }
+    size_t index;
+    size_t slot;
+    if (Search(*table, first, second, tag, key, &index, &slot)) {
+      fn(*table, index, slot);
+      return true;
+    }
+    if (table->stash_size.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+    concurrent_internal::StripeGuard stash_guard(&StashStripe());
+    if (!SearchStash(*table, tag, key, &index, &slot)) {
+      return false;
+    }
+    fn(*table, index, slot);
+    return true;
+  }
+}
+
+// With both buckets full, the locks are dropped to search for and walk a
+// displacement path, then the insert starts over. Only when no path is
+// found does the entry go to the stash, and only a full stash grows.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Update, class... Args>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Upsert(
+    const KeyType &key, Update &&update, bool update_new, Args &&... args) {
+  size_t hash = hasher_(key);
+  uint8_t tag = TagOf(hash);
+  bool use_stash = false;
+  while (true) {
+    Table *table = table_.load(std::memory_order_acquire);
+    size_t first = hash & table->mask;
+    size_t second = table->AltIndex(first, tag);
+    {
+      concurrent_internal::StripePairGuard guard(&StripeOf(first),
+                                                 &StripeOf(second));
+      if (table_.load(std::memory_order_acquire) != table) {
+        continue;
+      }
+      size_t index;
+      size_t slot;
+      if (Search(*table, first, second, tag, key, &index, &slot)) {
+        update(table->buckets[index].slot(slot).second);
+        return false;
+      }
+      if (table->stash_size.load(std::memory_order_relaxed) != 0) {
+        concurrent_internal::StripeGuard stash_guard(&StashStripe());
+        if (SearchStash(*table, tag, key, &index, &slot)) {
+          update(table->buckets[index].slot(slot).second);
+          return false;
+        }
+      }
+      if (table->FreeSlotIn(first, second, &index, &slot)) {
+        table->Store(index, slot, tag, std::forward<Args>(args)...);
+        StripeOf(first).count.fetch_add(1, std::memory_order_relaxed);
+        if (update_new) {
+          update(table->buckets[index].slot(slot).second);
+        }
+        return true;
+      }
+      if (use_stash) {
+        concurrent_internal::StripeGuard stash_guard(&StashStripe());
+        if (table->FreeStashSlot(&index, &slot)) {
+          table->Store(index, slot, tag, std::forward<Args>(args)...);
+          table->stash_size.fetch_add(1, std::memory_order_relaxed);
+          StripeOf(first).count.fetch_add(1, std::memory_order_relaxed);
+          if (update_new) {
+            update(table->buckets[index].slot(slot).second);
+          }
+          return true;
+        }
+      }
+    }
+    if (use_stash) {
+      Grow(table);
+      use_stash = false;
+      continue;
+    }
+    Path path;
+    if (table->FindPath(first, second, &path)) {
+      WalkPath(path, [this, table](size_t from, size_t slot, size_t to) {
+        return MoveLocked(table, from, slot, to);
+      });
+    } else {
+      use_stash = true;
+    }
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::MoveLocked(
+    Table *table, size_t from, size_t slot, size_t to) {
+  concurrent_internal::StripePairGuard guard(&StripeOf(from), &StripeOf(to));
+  return table_.load(std::memory_order_acquire) == table &&
+         table->Move(from, slot, to);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Entry>
+bool ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Place(
+    Table *table, Entry &&elem, size_t hash) {
+  uint8_t tag = TagOf(hash);
+  size_t first = hash & table->mask;
+  size_t second = table->AltIndex(first, tag);
+  size_t index;
+  size_t slot;
+  Path path;
+  while (!table->FreeSlotIn(first, second, &index, &slot)) {
+    bool moved =
+        table->FindPath(first, second, &path) &&
+        WalkPath(path, [table](size_t from, size_t from_slot, size_t to) {
+          return table->Move(from, from_slot, to);
+        });
+    if (!moved) {
+      if (!table->FreeStashSlot(&index, &slot)) {
+        return false;
+      }
+      table->stash_size.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+  table->Store(index, slot, tag, std::forward<Entry>(elem));
+  return true;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::TakeEntries(
+    Table *table) -> std::vector<ConstKeyValuePair> {
+  std::vector<ConstKeyValuePair> entries;
+  for (size_t index = 0; index < table->buckets.size(); ++index) {
+    Bucket &bucket = table->buckets[index];
+    for (size_t i = 0; i < kSlots; ++i) {
+      if (bucket.tags[i].load(std::memory_order_relaxed) != 0) {
+        entries.push_back(std::move(bucket.slot(i)));
+        table->Destroy(index, i);
+      }
+    }
+  }
+  table->stash_size.store(0, std::memory_order_relaxed);
+  return entries;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ptrdiff_t ConcurrentCuckooHashMap<KeyType, ValueType, Hash,
+                                  KeyEqual>::CountEntries() const {
+  ptrdiff_t count = 0;
+  for (size_t i = 0; i <= kStripes; ++i) {
+    count += stripes_[i].count.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Grow(
+    const Table *seen) {
+  concurrent_internal::StripeRangeGuard guard(stripes_.get(), kStripes + 1);
+  Table *table = table_.load(std::memory_order_relaxed);
+  if (table != seen) {
+    return;
+  }
+  size_t count = CountEntries();
+  if (count + 1 >= table->bucket_count() * 2 * kSlots * kMinLoadFactor) {
+    Rebuild(table->bucket_count() * 2, table->stash_buckets());
+  } else {
+    Rebuild(table->bucket_count(), table->stash_buckets() * 2);
+  }
+}
+
+// Grows again, by the same rule as Grow(), whenever the entries do not all
+// fit. Per-stripe counts are reset, since entries now have other buckets.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void ConcurrentCuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Rebuild(
+    size_t bucket_count, size_t stash_buckets) {
+  std::vector<ConstKeyValuePair> entries =
+      TakeEntries(table_.load(std::memory_order_relaxed));
+  while (true) {
+    auto table = std::make_unique<Table>(bucket_count, stash_buckets);
+    size_t placed = 0;
+    while (placed < entries.size() &&
+           Place(table.get(), std::move(entries[placed]),
+                 hasher_(entries[placed].first))) {
+      ++placed;
+    }
+    if (placed == entries.size()) {
+      for (size_t i = 0; i <= kStripes; ++i) {
+        stripes_[i].count.store(0, std::memory_order_relaxed);
+      }
+      stripes_[0].count.store(entries.size(), std::memory_order_relaxed);
+      tables_.push_back(std::move(table));
+      table_.store(tables_.back().get(), std::memory_order_release);
+      return;
+    }
+    std::vector<ConstKeyValuePair> rest = TakeEntries(table.get());
+    for (size_t i = placed; i < entries.size(); ++i) {
+      rest.push_back(std::move(entries[i]));
+    }
+    entries.swap(rest);
+    if (entries.size() >= bucket_count * 2 * kSlots * kMinLoadFactor) {
+      bucket_count <<= 1;
+    } else {
+      stash_buckets <<= 1;
+    }
+  }
+}
@@ -0,0 +1,680 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash_functions.h"
+
+// Bucketized cuckoo hash table with the interface of HashMap. A key lives in
+// one of its two buckets, or in a stash when no displacement path is found,
+// so find() checks at most two buckets and the stash and never walks a
+// chain. Entries are stored in the buckets. Buckets are aligned to 64
+// bytes and hold four slots, or as many down to two as fit in 64 bytes
+// with their tags: a bucket of two ints or two uint64_t is one cache line,
+// and larger buckets never share a line.
+//
+// A full stash grows the table. Only when a hash maps so many keys to the
+// same buckets that growing would leave the table nearly empty does the
+// stash get more buckets instead, making lookups slower but still correct.
+//
+// Every slot keeps an 8-bit tag from the high bits of the hash. The second
+// bucket is computed from the first and the tag, which lets insert move an
+// entry to its other bucket without hashing the key again.
+//
+// Inserting may move other entries and invalidates iterators; erasing
+// invalidates only iterators to the erased entry. Moving an entry
+// move-constructs the pair, which copies the const key.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class CuckooHashMap {
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+  static constexpr size_t kCacheLine = 64;
+
+  // A bucket of `slots` slots: the tags, padded to the pair's alignment,
+  // then the pairs.
+  static constexpr size_t BucketBytes(size_t slots) {
+    size_t align = alignof(ConstKeyValuePair);
+    return (slots + align - 1) / align * align +
+           slots * sizeof(ConstKeyValuePair);
+  }
+
+  static constexpr size_t SlotsPerLine() {
+    size_t slots = 4;
+    while (slots > 2 && BucketBytes(slots) > kCacheLine) {
+      --slots;
+    }
+    return slots;
+  }
+
+  static constexpr size_t kSlots = SlotsPerLine();
+
+  using SlotStorage = std::aligned_storage_t<sizeof(ConstKeyValuePair),
+                                             alignof(ConstKeyValuePair)>;
+
+  struct alignas(kCacheLine) Bucket {
+    Bucket() = default;
+    Bucket(const Bucket &other) = delete;
+    Bucket &operator=(const Bucket &other) = delete;
+
+    ~Bucket() {
+      for (size_t i = 0; i < kSlots; ++i) {
+        if (tags[i] != 0) {
+          std::destroy_at(&slot(i));
+        }
+      }
+    }
+
+    ConstKeyValuePair &slot(size_t i) {
+      return *std::launder(reinterpret_cast<ConstKeyValuePair *>(&storage[i]));
+    }
+
+    const ConstKeyValuePair &slot(size_t i) const {
+      return *std::launder(
+          reinterpret_cast<const ConstKeyValuePair *>(&storage[i]));
+    }
+
+    uint8_t tags[kSlots] = {};  // 0 marks a free slot
+    SlotStorage storage[kSlots];
+  };
+
+  static_assert(sizeof(Bucket) % kCacheLine == 0,
+                "buckets must not straddle cache lines");
+  static_assert(BucketBytes(kSlots) > kCacheLine ||
+                    sizeof(Bucket) == kCacheLine,
+                "a bucket that fits in a cache line must take one line");
+
+  // Walks the slots of all buckets, the stash included, in storage order.
+  template <class BucketPointer, class Value>
+  class SlotIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ConstKeyValuePair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value *;
+    using reference = Value &;
+
+    SlotIterator() = default;
+
+    SlotIterator(BucketPointer buckets, size_t pos, size_t end)
+        : buckets_(buckets), pos_(pos), end_(end) {
+      SkipFree();
+    }
+
+    template <class OtherPointer, class OtherValue,
+              class = std::enable_if_t<
+                  std::is_convertible<OtherPointer, BucketPointer>::value>>
+    SlotIterator(const SlotIterator<OtherPointer, OtherValue> &other)
+        : buckets_(other.buckets_), pos_(other.pos_), end_(other.end_) {}
+
+    reference operator*() const {
+      return buckets_[pos_ / kSlots].slot(pos_ % kSlots);
+    }
+
+    pointer operator->() const {
+      return &**this;
+    }
+
+    SlotIterator &operator++() {
+      ++pos_;
+      SkipFree();
+      return *this;
+    }
+
+    SlotIterator operator++(int) {
+      SlotIterator copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    friend bool operator==(const SlotIterator &lhs, const SlotIterator &rhs) {
+      return lhs.pos_ == rhs.pos_;
+    }
+
+    friend bool operator!=(const SlotIterator &lhs, const SlotIterator &rhs) {
+      return lhs.pos_ != rhs.pos_;
+    }
+
+   private:
+    template <class, class>
+    friend class SlotIterator;
+
+    void SkipFree() {
+      while (pos_ < end_ && buckets_[pos_ / kSlots].tags[pos_ % kSlots] == 0) {
+        ++pos_;
+      }
+    }
+
+    BucketPointer buckets_ = nullptr;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+  };
+
+ public:
+  using iterator = SlotIterator<Bucket *, ConstKeyValuePair>;
+  using const_iterator = SlotIterator<const Bucket *, const ConstKeyValuePair>;
+
+  CuckooHashMap(const Hash &hash = RandomlySeededHash<Hash>(),
+                const KeyEqual &equal = KeyEqual());
+
+  template <class ContainerIterator>
+  CuckooHashMap(ContainerIterator begin, ContainerIterator end,
+                const Hash &hash = RandomlySeededHash<Hash>(),
+                const KeyEqual &equal = KeyEqual());
+
+  CuckooHashMap(std::initializer_list<ConstKeyValuePair> initial,
+                const Hash &hash = RandomlySeededHash<Hash>(),
+                const KeyEqual &equal = KeyEqual());
+
+  CuckooHashMap(const CuckooHashMap &other);
+
+  ~CuckooHashMap() = default;
+
+  ValueType &operator[](const KeyType &key);
+
+  CuckooHashMap &operator=(const CuckooHashMap &other);
+
+  const ValueType &at(const KeyType &key) const;
+
+  void insert(const ConstKeyValuePair &elem);
+
+  void erase(const KeyType &key);
+
+  iterator find(const KeyType &key) {
+    return iterator(buckets_.data(), Locate(key, hasher_(key)), EndPos());
+  }
+
+  const_iterator find(const KeyType &key) const {
+    return const_iterator(buckets_.data(), Locate(key, hasher_(key)),
+                          EndPos());
+  }
+
+  bool contains(const KeyType &key) const {
+    return Locate(key, hasher_(key)) != EndPos();
+  }
+
+  iterator begin() {
+    return iterator(buckets_.data(), 0, EndPos());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(buckets_.data(), 0, EndPos());
+  }
+
+  iterator end() {
+    return iterator(buckets_.data(), EndPos(), EndPos());
+  }
+
+  const_iterator end() const {
+    return const_iterator(buckets_.data(), EndPos(), EndPos());
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  Hash hash_function() const {
+    return hasher_;
+  }
+
+  KeyEqual key_eq() const {
+    return key_equal_;
+  }
+
+  void clear();
+
+  // Sizes the table so that `count` entries fit without growing.
+  void reserve(size_t count);
+
+  // Entries per bucket: 4, or fewer for pairs too large for 4 in a line.
+  static constexpr size_t slots_per_bucket() {
+    return kSlots;
+  }
+
+  // Buckets of slots_per_bucket() entries, not counting the stash.
+  size_t bucket_count() const {
+    return buckets_.size() - stash_buckets_;
+  }
+
+  // Entries that found no room in either of their buckets.
+  size_t stash_size() const {
+    return stash_size_;
+  }
+
+  double load_factor() const {
+    return static_cast<double>(size_) / (bucket_count() * kSlots);
+  }
+
+ private:
+  static constexpr double kMaxLoadFactor = 0.9;
+  // A failed insert grows the table only if its load stays above this.
+  static constexpr double kMinLoadFactor = 0.125;
+  static constexpr size_t kMaxSearch = 256;  // BFS nodes per displacement
+  static constexpr size_t kNoParent = std::numeric_limits<size_t>::max();
+  const size_t initialBuckets_ = 2;
+
+  // A bucket reached by the displacement search: the entry in `slot` of the
+  // parent's bucket would move here.
+  struct PathNode {
+    size_t bucket;
+    size_t parent;
+    size_t slot;
+  };
+
+  static uint8_t TagOf(size_t hash) {
+    auto tag = static_cast<uint8_t>(
+        hash >> (std::numeric_limits<size_t>::digits - 8));
+    return tag != 0 ? tag : 1;
+  }
+
+  size_t AltIndex(size_t index, uint8_t tag) const {
+    return (index ^ ((tag + size_t{1}) * 0x5bd1e995)) & mask_;
+  }
+
+  size_t StashIndex() const {
+    return bucket_count();
+  }
+
+  size_t EndPos() const {
+    return buckets_.size() * kSlots;
+  }
+
+  ConstKeyValuePair &SlotAt(size_t pos) {
+    return buckets_[pos / kSlots].slot(pos % kSlots);
+  }
+
+  // Position of the entry with `key`, or EndPos().
+  size_t Locate(const KeyType &key, size_t hash) const;
+
+  bool ScanBucket(size_t index, uint8_t tag, const KeyType &key,
+                  size_t *pos) const;
+
+  bool FreeSlot(size_t index, size_t *slot) const;
+
+  // Empties a slot in bucket `first` or `second` by moving entries along a
+  // breadth-first displacement path.
+  bool Displace(size_t first, size_t second, size_t *index, size_t *slot);
+
+  void Move(size_t from, size_t from_slot, size_t to, size_t to_slot);
+
+  // Stores a new entry without growing; false if even the stash is full.
+  template <class Entry>
+  bool Place(Entry &&elem, size_t hash, size_t *pos);
+
+  // Stores an entry known to be absent, growing as needed.
+  template <class Entry>
+  size_t InsertNew(Entry &&elem, size_t hash);
+
+  // Moves every entry out of the table.
+  std::vector<ConstKeyValuePair> TakeEntries();
+
+  // Grows after an insert found no room.
+  void GrowForPlacement();
+
+  void Resize(size_t bucket_count, size_t stash_buckets);
+
+  size_t size_ = 0;
+  size_t stash_size_ = 0;
+  size_t stash_buckets_ = 1;
+  size_t mask_ = initialBuckets_ - 1;
+  std::vector<Bucket> buckets_ =
+      std::vector<Bucket>(initialBuckets_ + stash_buckets_);
+  Hash hasher_;
+  KeyEqual key_equal_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::CuckooHashMap(
+    const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class ContainerIterator>
+CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::CuckooHashMap(
+    ContainerIterator begin, ContainerIterator end, const Hash &hash,
+    const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (auto element = begin; element != end; ++element) {
+    insert(*element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::CuckooHashMap(
+    std::initializer_list<ConstKeyValuePair> initial, const Hash &hash,
+    const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (const auto &element : initial) {
+    insert(element);
+  }
+}
+
+// Copies slot by slot; the hasher is shared, so every entry keeps its place.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::CuckooHashMap(
+    const CuckooHashMap &other)
+    : size_(other.size_),
+      stash_size_(other.stash_size_),
+      stash_buckets_(other.stash_buckets_),
+      mask_(other.mask_),
+      buckets_(other.buckets_.size()),
+      hasher_(other.hasher_),
+      key_equal_(other.key_equal_) {
+  for (size_t index = 0; index < buckets_.size(); ++index) {
+    const Bucket &from = other.buckets_[index];
+    Bucket &to = buckets_[index];
+    for (size_t i = 0; i < kSlots; ++i) {
+      if (from.tags[i] != 0) {
+        new (&to.storage[i]) ConstKeyValuePair(from.slot(i));
+        to.tags[i] = from.tags[i];
+      }
+    }
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType &CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::operator[](
+    const KeyType &key) {
+  size_t hash = hasher_(key);
+  size_t pos = Locate(key, hash);
+  if (pos == EndPos()) {
+    pos = InsertNew(ConstKeyValuePair(key, ValueType()), hash);
+  }
+  return SlotAt(pos).second;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::operator=(
+    const CuckooHashMap &other) -> CuckooHashMap & {
+  if (this != &other) {
+    CuckooHashMap copy(other);
+    std::swap(size_, copy.size_);
+    std::swap(stash_size_, copy.stash_size_);
+    std::swap(stash_buckets_, copy.stash_buckets_);
+    std::swap(mask_, copy.mask_);
+    buckets_.swap(copy.buckets_);
+    std::swap(hasher_, copy.hasher_);
+    std::swap(key_equal_, copy.key_equal_);
+  }
+  return *this;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+const ValueType &CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::at(
+    const KeyType &key) const {
+  const_iterator it = find(key);
+  if (it != end()) {
+    return it->second;
+  }
+  throw std::out_of_range("Bad request");
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::insert(
+    const ConstKeyValuePair &elem) {
+  size_t hash = hasher_(elem.first);
+  if (Locate(elem.first, hash) == EndPos()) {
+    InsertNew(elem, hash);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::erase(
+    const KeyType &key) {
+  size_t pos = Locate(key, hasher_(key));
+  if (pos == EndPos()) {
+    return;
+  }
+  Bucket &bucket = buckets_[pos / kSlots];
+  std::destroy_at(&bucket.slot(pos % kSlots));
+  bucket.tags[pos % kSlots] = 0;
+  --size_;
+  if (pos / kSlots >= StashIndex()) {
+    --stash_size_;
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::clear() {
+  size_ = 0;
+  stash_size_ = 0;
+  stash_buckets_ = 1;
+  mask_ = initialBuckets_ - 1;
+  buckets_ = std::vector<Bucket>(initialBuckets_ + stash_buckets_);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::reserve(
+    size_t count) {
+  size_t new_count = bucket_count();
+  while (count > new_count * kSlots * kMaxLoadFactor) {
+    new_count <<= 1;
+  }
+  if (new_count != bucket_count()) {
+    Resize(new_count, stash_buckets_);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+size_t CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Locate(
+    const KeyType &key, size_t hash) const {
+  uint8_t tag = TagOf(hash);
+  size_t first = hash & mask_;
+  size_t pos = EndPos();
+  if (ScanBucket(first, tag, key, &pos) ||
+      ScanBucket(AltIndex(first, tag), tag, key, &pos)) {
+    return pos;
+  }
+  if (stash_size_ != 0) {
+    for (size_t index = StashIndex(); index < buckets_.size(); ++index) {
+      if (ScanBucket(index, tag, key, &pos)) {
+        return pos;
+      }
+    }
+  }
+  return EndPos();
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::ScanBucket(
+    size_t index, uint8_t tag, const KeyType &key, size_t *pos) const {
+  const Bucket &bucket = buckets_[index];
+  for (size_t i = 0; i < kSlots; ++i) {
+    if (bucket.tags[i] == tag && key_equal_(bucket.slot(i).first, key)) {
+      *pos = index * kSlots + i;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::FreeSlot(
+    size_t index, size_t *slot) const {
+  const Bucket &bucket = buckets_[index];
+  for (size_t i = 0; i < kSlots; ++i) {
+    if (bucket.tags[i] == 0) {
+      *slot = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Buckets already on a path are not revisited, so each move along the path
+// takes an entry that is still in the slot the search saw it in.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Displace(
+    size_t first, size_t second, size_t *index, size_t *slot) {
+  std::array<PathNode, kMaxSearch> nodes;
+  size_t count = 0;
+  nodes[count++] = {first, kNoParent, 0};
+  if (second != first) {
+    nodes[count++] = {second, kNoParent, 0};
+  }
+  for (size_t head = 0; head < count; ++head) {
+    size_t bucket = nodes[head].bucket;
+    for (size_t i = 0; i < kSlots; ++i) {
+      size_t alt = AltIndex(bucket, buckets_[bucket].tags[i]);
+      size_t free_slot;
+      if (FreeSlot(alt, &free_slot)) {
+        size_t node = head;
+        size_t from_slot = i;
+        size_t to = alt;
+        size_t to_slot = free_slot;
+        while (true) {
+          Move(nodes[node].bucket, from_slot, to, to_slot);
+          if (nodes[node].parent == kNoParent) {
+            *index = nodes[node].bucket;
+            *slot = from_slot;
+            return true;
+          }
+          to = nodes[node].bucket;
+          to_slot = from_slot;
+          from_slot = nodes[node].slot;
+          node = nodes[node].parent;
+        }
+      }
+      bool on_path = false;
+      for (size_t n = head; n != kNoParent && !on_path; n = nodes[n].parent) {
+        on_path = nodes[n].bucket == alt;
+      }
+      if (!on_path && count < kMaxSearch) {
+        nodes[count++] = {alt, head, i};
+      }
+    }
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Move(
+    size_t from, size_t from_slot, size_t to, size_t to_slot) {
+  Bucket &source = buckets_[from];
+  Bucket &target = buckets_[to];
+  new (&target.storage[to_slot])
+      ConstKeyValuePair(std::move(source.slot(from_slot)));
+  target.tags[to_slot] = source.tags[from_slot];
+  std::destroy_at(&source.slot(from_slot));
+  source.tags[from_slot] = 0;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Entry>
+bool CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Place(
+    Entry &&elem, size_t hash, size_t *pos) {
+  uint8_t tag = TagOf(hash);
+  size_t first = hash & mask_;
+  size_t second = AltIndex(first, tag);
+  size_t index = first;
+  size_t slot;
+  if (!FreeSlot(first, &slot)) {
+    index = second;
+    if (!FreeSlot(second, &slot) && !Displace(first, second, &index, &slot)) {
+      index = StashIndex();
+      while (index < buckets_.size() && !FreeSlot(index, &slot)) {
+        ++index;
+      }
+      if (index == buckets_.size()) {
+        return false;
+      }
+      ++stash_size_;
+    }
+  }
+  Bucket &bucket = buckets_[index];
+  new (&bucket.storage[slot]) ConstKeyValuePair(std::forward<Entry>(elem));
+  bucket.tags[slot] = tag;
+  *pos = index * kSlots + slot;
+  return true;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Entry>
+size_t CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::InsertNew(
+    Entry &&elem, size_t hash) {
+  if (size_ + 1 > bucket_count() * kSlots * kMaxLoadFactor) {
+    Resize(bucket_count() * 2, 1);
+  }
+  size_t pos;
+  while (!Place(std::forward<Entry>(elem), hash, &pos)) {
+    GrowForPlacement();
+  }
+  ++size_;
+  return pos;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::TakeEntries()
+    -> std::vector<ConstKeyValuePair> {
+  std::vector<ConstKeyValuePair> entries;
+  entries.reserve(size_);
+  for (Bucket &bucket : buckets_) {
+    for (size_t i = 0; i < kSlots; ++i) {
+      if (bucket.tags[i] != 0) {
+        entries.push_back(std::move(bucket.slot(i)));
+        std::destroy_at(&bucket.slot(i));
+        bucket.tags[i] = 0;
+      }
+    }
+  }
+  stash_size_ = 0;
+  return entries;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::GrowForPlacement() {
+  if (size_ + 1 >= bucket_count() * 2 * kSlots * kMinLoadFactor) {
+    Resize(bucket_count() * 2, stash_buckets_);
+  } else {
+    Resize(bucket_count(), stash_buckets_ * 2);
+  }
+}
+
+// Grows again, by the same rule as GrowForPlacement(), whenever the entries
+// do not all fit. The stash eventually holds everything, so this ends.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void CuckooHashMap<KeyType, ValueType, Hash, KeyEqual>::Resize(
+    size_t bucket_count, size_t stash_buckets) {
+  std::vector<ConstKeyValuePair> entries = TakeEntries();
+  while (true) {
+    buckets_ = std::vector<Bucket>(bucket_count + stash_buckets);
+    stash_buckets_ = stash_buckets;
+    mask_ = bucket_count - 1;
+    size_t placed = 0;
+    size_t pos;
+    while (placed < entries.size() &&
+           Place(std::move(entries[placed]), hasher_(entries[placed].first),
+                 &pos)) {
+      ++placed;
+    }
+    if (placed == entries.size()) {
+      return;
+    }
+    std::vector<ConstKeyValuePair> rest = TakeEntries();
+    for (size_t i = placed; i < entries.size(); ++i) {
+      rest.push_back(std::move(entries[i]));
+    }
+    entries.swap(rest);
+    if (entries.size() >= bucket_count * 2 * kSlots * kMinLoadFactor) {
+      bucket_count <<= 1;
+    } else {
+      stash_buckets <<= 1;
+    }
+  }
+}
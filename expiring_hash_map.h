@@ -0,0 +1,304 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "hash_map.h"
+
+// HashMap with a time-to-live per entry. Expired entries are treated as
+// absent by every lookup and erased when touched; the rest are reclaimed by
+// sweep(), which walks a hierarchical timer wheel and does work bounded by
+// its argument instead of scanning the whole map.
+//
+// The wheel has kLevels levels of kSlots slots; a slot of level L spans
+// kSlots^L ticks of `resolution`. Entries are linked into their slot through
+// the map nodes themselves, so the wheel allocates nothing per entry.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>,
+          class Clock = std::chrono::steady_clock>
+class ExpiringHashMap {
+  struct Slot;
+  using Map = HashMap<KeyType, Slot, Hash, KeyEqual>;
+  using MapIterator = typename Map::iterator;
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+ public:
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+
+  explicit ExpiringHashMap(Duration resolution = std::chrono::milliseconds(1),
+                           const Hash &hash = RandomlySeededHash<Hash>(),
+                           const KeyEqual &equal = KeyEqual());
+
+  ExpiringHashMap(const ExpiringHashMap &other) = delete;
+
+  ExpiringHashMap &operator=(const ExpiringHashMap &other) = delete;
+
+  // Does nothing if a live entry with this key exists.
+  void insert(const ConstKeyValuePair &elem, Duration ttl);
+
+  // Returns nullptr if the key is absent or expired.
+  ValueType *find(const KeyType &key);
+
+  bool contains(const KeyType &key) {
+    return find(key) != nullptr;
+  }
+
+  // Restarts the entry's time to live; false if it is absent or expired.
+  bool expire_after(const KeyType &key, Duration ttl);
+
+  void erase(const KeyType &key);
+
+  // Reclaims at most `max_expired` entries whose deadline has passed and
+  // returns how many were reclaimed. Call it periodically.
+  size_t sweep(size_t max_expired);
+
+  // Includes expired entries not reclaimed yet.
+  size_t size() const {
+    return map_.size();
+  }
+
+  bool empty() const {
+    return map_.empty();
+  }
+
+  void clear();
+
+ private:
+  static constexpr size_t kLevelBits = 6;
+  static constexpr size_t kSlots = size_t(1) << kLevelBits;
+  static constexpr size_t kLevels = 4;
+  static constexpr uint64_t kMaxDelta =
+      (uint64_t(1) << (kLevelBits * kLevels)) - 1;
+
+  struct Slot {
+    ValueType value;
+    TimePoint deadline;
+    MapIterator timer_prev;
+    MapIterator timer_next;
+    size_t wheel_slot;  // index into wheel_
+  };
+
+  uint64_t TickOf(TimePoint time) const {
+    if (time <= origin_) {
+      return 0;
+    }
+    return static_cast<uint64_t>((time - origin_) / resolution_);
+  }
+
+  // The entry with `key`, or map_.end() if it is absent or expired; an
+  // expired one is removed.
+  MapIterator FindLive(const KeyType &key);
+
+  void Schedule(MapIterator entry);
+
+  void Unschedule(MapIterator entry);
+
+  void Remove(MapIterator entry);
+
+  void Cascade(size_t wheel_slot);
+
+  Map map_;
+  std::array<MapIterator, kSlots * kLevels> wheel_;  // map_.end() if empty
+  std::array<size_t, kLevels> level_size_ = {};
+  Duration resolution_;
+  TimePoint origin_;
+  uint64_t next_tick_ = 0;  // ticks before it have been swept
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::ExpiringHashMap(
+    Duration resolution, const Hash &hash, const KeyEqual &equal)
+    : map_(hash, equal), resolution_(resolution), origin_(Clock::now()) {
+  wheel_.fill(map_.end());
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::insert(
+    const ConstKeyValuePair &elem, Duration ttl) {
+  if (FindLive(elem.first) != map_.end()) {
+    return;
+  }
+  map_.insert({elem.first, Slot{elem.second, Clock::now() + ttl, map_.end(),
+                                map_.end(), 0}});
+  Schedule(map_.begin());
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+ValueType *ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::find(
+    const KeyType &key) {
+  MapIterator it = FindLive(key);
+  return it != map_.end() ? &it->second.value : nullptr;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+bool ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::expire_after(
+    const KeyType &key, Duration ttl) {
+  MapIterator it = FindLive(key);
+  if (it == map_.end()) {
+    return false;
+  }
+  Unschedule(it);
+  it->second.deadline = Clock::now() + ttl;
+  Schedule(it);
+  return true;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::erase(
+    const KeyType &key) {
+  MapIterator it = map_.find(key);
+  if (it != map_.end()) {
+    Remove(it);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+size_t ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::sweep(
+    size_t max_expired) {
+  TimePoint now = Clock::now();
+  uint64_t now_tick = TickOf(now);
+  size_t expired = 0;
+  // A tick is swept only once it is over, so every entry due in it expired.
+  while (next_tick_ < now_tick && expired < max_expired) {
+    // Skip ahead to the next tick that can hold or cascade entries.
+    size_t empty_levels = 0;
+    while (empty_levels < kLevels && level_size_[empty_levels] == 0) {
+      ++empty_levels;
+    }
+    if (empty_levels == kLevels) {
+      next_tick_ = now_tick;
+      break;
+    }
+    if (empty_levels > 0) {
+      uint64_t span = uint64_t(1) << (kLevelBits * empty_levels);
+      uint64_t skip_to = (next_tick_ + span - 1) / span * span;
+      if (skip_to >= now_tick) {
+        next_tick_ = now_tick;
+        break;
+      }
+      next_tick_ = skip_to;
+    }
+    for (size_t level = 1; level < kLevels; ++level) {
+      if (next_tick_ & ((uint64_t(1) << (kLevelBits * level)) - 1)) {
+        break;
+      }
+      Cascade(level * kSlots +
+              ((next_tick_ >> (kLevelBits * level)) & (kSlots - 1)));
+    }
+    size_t wheel_slot = next_tick_ & (kSlots - 1);
+    while (wheel_[wheel_slot] != map_.end() && expired < max_expired) {
+      MapIterator entry = wheel_[wheel_slot];
+      if (entry->second.deadline <= now) {
+        Remove(entry);
+        ++expired;
+      } else {
+        // Scheduled beyond the wheel's range; move it closer.
+        Unschedule(entry);
+        Schedule(entry);
+      }
+    }
+    if (wheel_[wheel_slot] == map_.end()) {
+      ++next_tick_;
+    }
+  }
+  return expired;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::clear() {
+  map_.clear();
+  wheel_.fill(map_.end());
+  level_size_.fill(0);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+auto ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::FindLive(
+    const KeyType &key) -> MapIterator {
+  MapIterator it = map_.find(key);
+  if (it != map_.end() && it->second.deadline <= Clock::now()) {
+    Remove(it);
+    return map_.end();
+  }
+  return it;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::Schedule(
+    MapIterator entry) {
+  uint64_t tick = TickOf(entry->second.deadline);
+  if (tick < next_tick_) {
+    tick = next_tick_;
+  }
+  if (tick - next_tick_ > kMaxDelta) {
+    tick = next_tick_ + kMaxDelta;
+  }
+  uint64_t delta = tick - next_tick_;
+  size_t level = 0;
+  while (delta >> (kLevelBits * (level + 1))) {
+    ++level;
+  }
+  size_t wheel_slot =
+      level * kSlots + ((tick >> (kLevelBits * level)) & (kSlots - 1));
+  Slot &slot = entry->second;
+  slot.wheel_slot = wheel_slot;
+  slot.timer_prev = map_.end();
+  slot.timer_next = wheel_[wheel_slot];
+  if (slot.timer_next != map_.end()) {
+    slot.timer_next->second.timer_prev = entry;
+  }
+  wheel_[wheel_slot] = entry;
+  ++level_size_[level];
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::Unschedule(
+    MapIterator entry) {
+  Slot &slot = entry->second;
+  if (slot.timer_prev != map_.end()) {
+    slot.timer_prev->second.timer_next = slot.timer_next;
+  } else {
+    wheel_[slot.wheel_slot] = slot.timer_next;
+  }
+  if (slot.timer_next != map_.end()) {
+    slot.timer_next->second.timer_prev = slot.timer_prev;
+  }
+  --level_size_[slot.wheel_slot / kSlots];
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::Remove(
+    MapIterator entry) {
+  Unschedule(entry);
+  map_.erase(entry);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          class Clock>
+void ExpiringHashMap<KeyType, ValueType, Hash, KeyEqual, Clock>::Cascade(
+    size_t wheel_slot) {
+  MapIterator entry = wheel_[wheel_slot];
+  wheel_[wheel_slot] = map_.end();
+  while (entry != map_.end()) {
+    --level_size_[wheel_slot / kSlots];
+    MapIterator next = entry->second.timer_next;
+    Schedule(entry);
+    entry = next;
+  }
+}
@@ -0,0 +1,287 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "hash_functions.h"
+#include "hash_map.h"
+
+// Aggregates for HashAggregator. An aggregate folds the values of a group
+// into a State:
+//
+//   State Init(const Value &value) const;             // from the first row
+//   void Update(State *state, const Value &value) const;
+//
+// Any class of this shape works as a custom aggregate.
+
+template <class T>
+struct SumAggregate {
+  using State = T;
+
+  State Init(const T &value) const {
+    return value;
+  }
+
+  void Update(State *state, const T &value) const {
+    *state += value;
+  }
+};
+
+// Counts rows; the values are ignored.
+struct CountAggregate {
+  using State = size_t;
+
+  template <class Value>
+  State Init(const Value &) const {
+    return 1;
+  }
+
+  template <class Value>
+  void Update(State *state, const Value &) const {
+    ++*state;
+  }
+};
+
+template <class T, class Compare = std::less<T>>
+struct MinAggregate {
+  using State = T;
+
+  State Init(const T &value) const {
+    return value;
+  }
+
+  void Update(State *state, const T &value) const {
+    if (Compare()(value, *state)) {
+      *state = value;
+    }
+  }
+};
+
+template <class T>
+using MaxAggregate = MinAggregate<T, std::greater<T>>;
+
+// Group-by over columnar batches: row i of a batch is keys[i] and
+// values[i], and every group keeps one Aggregate::State in a HashMap.
+//
+// add_batch() hashes a block of rows first, then probes them, prefetching
+// the bucket slot of the row 2 * kPrefetchDistance ahead and the chain head
+// of the row kPrefetchDistance ahead, so that the cache misses of
+// neighbouring rows overlap. With partition_bits > 0 the groups are split
+// by the top hash bits into 2^partition_bits maps, and each block is
+// radix-sorted by partition before probing; when the groups outgrow the
+// cache, every partition then stays hot while its rows are processed.
+template <class KeyType, class Aggregate, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class HashAggregator {
+ public:
+  using State = typename Aggregate::State;
+  using Table = HashMap<KeyType, State, Hash, KeyEqual>;
+
+  explicit HashAggregator(size_t partition_bits = 0,
+                          const Aggregate &aggregate = Aggregate(),
+                          const Hash &hash = RandomlySeededHash<Hash>(),
+                          const KeyEqual &equal = KeyEqual());
+
+  // Folds rows [0, count) of the columns into their groups.
+  template <class Value>
+  void add_batch(const KeyType *keys, const Value *values, size_t count);
+
+  // The number of groups.
+  size_t size() const;
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  bool contains(const KeyType &key) const {
+    size_t hash = hasher_(key);
+    return partitions_[Partition(hash)].find(key, hash) !=
+           partitions_[Partition(hash)].end();
+  }
+
+  const State &at(const KeyType &key) const;
+
+  // Calls fn(key, state) for every group, partition by partition.
+  template <class Fn>
+  void for_each(Fn fn) const;
+
+  size_t partition_count() const {
+    return partitions_.size();
+  }
+
+  const Table &partition(size_t index) const {
+    return partitions_[index];
+  }
+
+  void clear();
+
+ private:
+  static constexpr size_t kBlock = 4096;  // rows hashed before probing
+  static constexpr size_t kPrefetchDistance = 8;
+  static constexpr size_t kMaxPartitionBits = 16;
+
+  size_t Partition(size_t hash) const {
+    return partition_bits_ == 0
+               ? 0
+               : hash >> (std::numeric_limits<size_t>::digits -
+                          partition_bits_);
+  }
+
+  // Orders the rows of a block by partition into order_, leaving the end of
+  // partition p in ends_[p].
+  void PartitionBlock(size_t count);
+
+  template <class Value>
+  void ProbeRows(Table *table, const KeyType *keys, const Value *values,
+                 const size_t *rows, size_t count);
+
+  size_t partition_bits_;
+  Aggregate aggregate_;
+  std::vector<Table> partitions_;
+  Hash hasher_;
+  std::vector<size_t> hashes_;  // per row of the current block
+  std::vector<size_t> order_;
+  std::vector<size_t> ends_;
+};
+
+// The partitions share one seed, so a row is hashed once for both choosing
+// its partition and probing it.
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::HashAggregator(
+    size_t partition_bits, const Aggregate &aggregate, const Hash &hash,
+    const KeyEqual &equal)
+    : partition_bits_(partition_bits), aggregate_(aggregate) {
+  if (partition_bits > kMaxPartitionBits) {
+    throw std::invalid_argument("too many partition bits");
+  }
+  size_t partitions = size_t{1} << partition_bits;
+  partitions_.reserve(partitions);
+  for (size_t i = 0; i < partitions; ++i) {
+    partitions_.emplace_back(hash, equal);
+  }
+  hasher_ = partitions_.front().hash_function();
+  hashes_.resize(kBlock);
+  order_.resize(kBlock);
+  ends_.resize(partitions);
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+template <class Value>
+void HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::add_batch(
+    const KeyType *keys, const Value *values, size_t count) {
+  for (size_t start = 0; start < count; start += kBlock) {
+    size_t rows = std::min(kBlock, count - start);
+    const KeyType *block_keys = keys + start;
+    const Value *block_values = values + start;
+    for (size_t i = 0; i < rows; ++i) {
+      hashes_[i] = hasher_(block_keys[i]);
+    }
+    if (partitions_.size() == 1) {
+      for (size_t i = 0; i < rows; ++i) {
+        order_[i] = i;
+      }
+      ProbeRows(&partitions_.front(), block_keys, block_values,
+                order_.data(), rows);
+      continue;
+    }
+    PartitionBlock(rows);
+    size_t begin = 0;
+    for (size_t p = 0; p < partitions_.size(); ++p) {
+      ProbeRows(&partitions_[p], block_keys, block_values,
+                order_.data() + begin, ends_[p] - begin);
+      begin = ends_[p];
+    }
+  }
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+size_t HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::size() const {
+  size_t groups = 0;
+  for (const Table &table : partitions_) {
+    groups += table.size();
+  }
+  return groups;
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+auto HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::at(
+    const KeyType &key) const -> const State & {
+  size_t hash = hasher_(key);
+  const Table &table = partitions_[Partition(hash)];
+  auto it = table.find(key, hash);
+  if (it != table.end()) {
+    return it->second;
+  }
+  throw std::out_of_range("Bad request");
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+template <class Fn>
+void HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::for_each(
+    Fn fn) const {
+  for (const Table &table : partitions_) {
+    for (const auto &group : table) {
+      fn(group.first, group.second);
+    }
+  }
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+void HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::clear() {
+  for (Table &table : partitions_) {
+    table.clear();
+  }
+}
+
+// A counting sort: count the rows of each partition, turn the counts into
+// starts, then place every row at its partition's next position.
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+void HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::PartitionBlock(
+    size_t count) {
+  std::fill(ends_.begin(), ends_.end(), 0);
+  for (size_t i = 0; i < count; ++i) {
+    ++ends_[Partition(hashes_[i])];
+  }
+  size_t start = 0;
+  for (size_t &end : ends_) {
+    size_t rows = end;
+    end = start;
+    start += rows;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    order_[ends_[Partition(hashes_[i])]++] = i;
+  }
+}
+
+template <class KeyType, class Aggregate, class Hash, class KeyEqual>
+template <class Value>
+void HashAggregator<KeyType, Aggregate, Hash, KeyEqual>::ProbeRows(
+    Table *table, const KeyType *keys, const Value *values, const size_t *rows,
+    size_t count) {
+  for (size_t i = 0; i < std::min(count, 2 * kPrefetchDistance); ++i) {
+    table->prefetch_bucket(hashes_[rows[i]]);
+  }
+  for (size_t i = 0; i < std::min(count, kPrefetchDistance); ++i) {
+    table->prefetch(hashes_[rows[i]]);
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (i + 2 * kPrefetchDistance < count) {
+      table->prefetch_bucket(hashes_[rows[i + 2 * kPrefetchDistance]]);
+    }
+    if (i + kPrefetchDistance < count) {
+      table->prefetch(hashes_[rows[i + kPrefetchDistance]]);
+    }
+    size_t row = rows[i];
+    const Value &value = values[row];
+    table->upsert(
+        keys[row], hashes_[row],
+        [this, &value](State &state) { aggregate_.Update(&state, value); },
+        [this, &value] { return aggregate_.Init(value); });
+  }
+}
@@ -0,0 +1,343 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASH_FUNCTIONS_SSE2 1
+#endif
+
+// Murmur3 fmix64: every input bit affects every output bit, so the low bits
+// kept by power-of-two masking still depend on the whole key.
+inline uint64_t MixBits(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+template <class KeyType>
+uint64_t KeyBits(KeyType key) {
+  if constexpr (std::is_pointer<KeyType>::value) {
+    return reinterpret_cast<uintptr_t>(key);
+  } else if constexpr (std::is_enum<KeyType>::value) {
+    return static_cast<uint64_t>(
+        static_cast<std::underlying_type_t<KeyType>>(key));
+  } else {
+    return static_cast<uint64_t>(key);
+  }
+}
+
+// A fresh seed per call: a per-process random base stepped by a Weyl
+// sequence, so maps created back to back still get unrelated seeds.
+inline uint64_t RandomSeed() {
+  static const uint64_t base =
+      (static_cast<uint64_t>(std::random_device()()) << 32) ^
+      std::random_device()();
+  static std::atomic<uint64_t> counter{0};
+  return MixBits(base + counter.fetch_add(0x9e3779b97f4a7c15ULL,
+                                          std::memory_order_relaxed));
+}
+
+// Hashers with reseed(uint64_t) can be seeded; see RandomlySeededHash.
+template <class Hash, class = void>
+struct IsSeedableHash : std::false_type {};
+
+template <class Hash>
+struct IsSeedableHash<
+    Hash, std::void_t<decltype(std::declval<Hash &>().reseed(uint64_t()))>>
+    : std::true_type {};
+
+// A default-constructed Hash, given a random seed if it is seedable. The
+// containers take it as their default hasher, so that a hasher passed in
+// keeps its seed.
+template <class Hash>
+Hash RandomlySeededHash() {
+  Hash hash;
+  if constexpr (IsSeedableHash<Hash>::value) {
+    hash.reseed(RandomSeed());
+  }
+  return hash;
+}
+
+// Hash for integral, enum and pointer keys. std::hash is the identity for
+// these on libstdc++, which maps keys sharing low bits to the same bucket.
+template <class KeyType>
+class IntegerHash {
+ public:
+  explicit IntegerHash(uint64_t seed = 0) : seed_(seed) {}
+
+  size_t operator()(KeyType key) const {
+    return static_cast<size_t>(MixBits(KeyBits(key) ^ seed_));
+  }
+
+  void reseed(uint64_t seed) {
+    seed_ = seed;
+  }
+
+ private:
+  uint64_t seed_;
+};
+
+namespace hash_internal {
+
+constexpr uint64_t kWyP0 = 0xa0761d6478bd642fULL;
+constexpr uint64_t kWyP1 = 0xe7037ed1a0b428dbULL;
+constexpr uint64_t kWyP2 = 0x8ebc6af09c88c6e3ULL;
+constexpr uint64_t kWyP3 = 0x589965cc75374cc3ULL;
+constexpr uint64_t kScramblePrime = 0x9e3779b1ULL;
+constexpr size_t kStripeSize = 64;
+constexpr size_t kStripesPerBlock = 8;
+constexpr size_t kLongInput = 256;  // shorter inputs take the wyhash path
+
+// First outputs of splitmix64 seeded with 0; stripe n is keyed with words
+// [n % 8, n % 8 + 8), the last stripe and scrambling use words [8, 16).
+alignas(16) constexpr uint64_t kStripeKey[16] = {
+    0xe220a8397b1dcdafULL, 0x6e789e6aa1b965f4ULL, 0x06c45d188009454fULL,
+    0xf88bb8a8724c81ecULL, 0x1b39896a51a8749bULL, 0x53cb9f0c747ea2eaULL,
+    0x2c829abe1f4532e1ULL, 0xc584133ac916ab3cULL, 0x3ee5789041c98ac3ULL,
+    0xf3b8488c368cb0a6ULL, 0x657eecdd3cb13d09ULL, 0xc2d326e0055bdef6ULL,
+    0x8621a03fe0bbdb7bULL, 0x8e1f7555983aa92fULL, 0xb54e0f1600cc4d19ULL,
+    0x84bb3f97971d80abULL};
+
+inline uint64_t Read64(const unsigned char *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t Read32(const unsigned char *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// 64x64->128 multiply folded back to 64 bits.
+inline uint64_t Mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a),
+           lb = static_cast<uint32_t>(b);
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  return lo ^ hi;
+#endif
+}
+
+inline uint64_t ShortHash(const unsigned char *p, size_t len, uint64_t seed) {
+  seed ^= Mum(seed ^ kWyP0, kWyP1);
+  uint64_t a = 0, b = 0;
+  if (len <= 16) {
+    if (len >= 4) {
+      size_t shift = (len >> 3) << 2;
+      a = (Read32(p) << 32) | Read32(p + shift);
+      b = (Read32(p + len - 4) << 32) | Read32(p + len - 4 - shift);
+    } else if (len > 0) {
+      a = (static_cast<uint64_t>(p[0]) << 16) |
+          (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+      do {
+        seed = Mum(Read64(p) ^ kWyP1, Read64(p + 8) ^ seed);
+        see1 = Mum(Read64(p + 16) ^ kWyP2, Read64(p + 24) ^ see1);
+        see2 = Mum(Read64(p + 32) ^ kWyP3, Read64(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = Mum(Read64(p) ^ kWyP1, Read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+    a = Read64(p + i - 16);
+    b = Read64(p + i - 8);
+  }
+  return Mum(kWyP1 ^ len, Mum(a ^ kWyP1, b ^ seed));
+}
+
+// One 64-byte stripe into eight 64-bit lanes, xxh3-style: each lane gets the
+// 32x32 product of its keyed input plus the raw input of its neighbour.
+inline void AccumulateStripeScalar(uint64_t *acc, const unsigned char *p,
+                                   const uint64_t *key) {
+  for (size_t i = 0; i < 8; ++i) {
+    uint64_t data = Read64(p + 8 * i);
+    uint64_t keyed = data ^ key[i];
+    acc[i ^ 1] += data;
+    acc[i] += (keyed & 0xffffffffULL) * (keyed >> 32);
+  }
+}
+
+inline void ScrambleScalar(uint64_t *acc, const uint64_t *key) {
+  for (size_t i = 0; i < 8; ++i) {
+    acc[i] = ((acc[i] ^ (acc[i] >> 47)) ^ key[i]) * kScramblePrime;
+  }
+}
+
+#ifdef HASH_FUNCTIONS_SSE2
+inline void AccumulateStripeSse2(__m128i *acc, const unsigned char *p,
+                                 const uint64_t *key) {
+  for (size_t i = 0; i < 4; ++i) {
+    __m128i data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + i);
+    __m128i keyed = _mm_xor_si128(
+        data, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + i));
+    __m128i keyed_hi = _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i product = _mm_mul_epu32(keyed, keyed_hi);
+    __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+  }
+}
+
+inline void ScrambleSse2(__m128i *acc, const uint64_t *key) {
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(kScramblePrime));
+  for (size_t i = 0; i < 4; ++i) {
+    __m128i x = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+    x = _mm_xor_si128(
+        x, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + i));
+    __m128i lo = _mm_mul_epu32(x, prime);
+    __m128i hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+    acc[i] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+  }
+}
+#endif
+
+inline uint64_t MergeAccumulators(const uint64_t *acc, size_t len,
+                                  uint64_t seed) {
+  uint64_t h = len * kWyP0 ^ seed;
+  for (size_t i = 0; i < 8; i += 2) {
+    h += Mum(acc[i] ^ kStripeKey[i + 1], acc[i + 1] ^ kStripeKey[i + 2]);
+  }
+  return MixBits(h);
+}
+
+inline void InitAccumulators(uint64_t *acc, uint64_t seed) {
+  for (size_t i = 0; i < 8; ++i) {
+    acc[i] = kStripeKey[i] + (i % 2 == 0 ? seed : ~seed);
+  }
+}
+
+inline uint64_t LongHashScalar(const unsigned char *p, size_t len,
+                               uint64_t seed) {
+  uint64_t acc[8];
+  InitAccumulators(acc, seed);
+  size_t stripes = (len - 1) / kStripeSize;
+  for (size_t n = 0; n < stripes; ++n) {
+    AccumulateStripeScalar(acc, p + n * kStripeSize,
+                           kStripeKey + n % kStripesPerBlock);
+    if (n % kStripesPerBlock == kStripesPerBlock - 1) {
+      ScrambleScalar(acc, kStripeKey + 8);
+    }
+  }
+  AccumulateStripeScalar(acc, p + len - kStripeSize, kStripeKey + 8);
+  return MergeAccumulators(acc, len, seed);
+}
+
+#ifdef HASH_FUNCTIONS_SSE2
+inline uint64_t LongHashSse2(const unsigned char *p, size_t len,
+                             uint64_t seed) {
+  alignas(16) uint64_t acc[8];
+  InitAccumulators(acc, seed);
+  size_t stripes = (len - 1) / kStripeSize;
+  __m128i lanes[4];
+  for (size_t i = 0; i < 4; ++i) {
+    lanes[i] = _mm_load_si128(reinterpret_cast<const __m128i *>(acc) + i);
+  }
+  for (size_t n = 0; n < stripes; ++n) {
+    AccumulateStripeSse2(lanes, p + n * kStripeSize,
+                         kStripeKey + n % kStripesPerBlock);
+    if (n % kStripesPerBlock == kStripesPerBlock - 1) {
+      ScrambleSse2(lanes, kStripeKey + 8);
+    }
+  }
+  AccumulateStripeSse2(lanes, p + len - kStripeSize, kStripeKey + 8);
+  for (size_t i = 0; i < 4; ++i) {
+    _mm_store_si128(reinterpret_cast<__m128i *>(acc) + i, lanes[i]);
+  }
+  return MergeAccumulators(acc, len, seed);
+}
+#endif
+
+// Inputs of at least kLongInput bytes: independent lanes, vectorized on
+// SSE2. The scalar and SSE2 paths produce identical results.
+inline uint64_t LongHash(const unsigned char *p, size_t len, uint64_t seed) {
+#ifdef HASH_FUNCTIONS_SSE2
+  return LongHashSse2(p, len, seed);
+#else
+  return LongHashScalar(p, len, seed);
+#endif
+}
+
+}  // namespace hash_internal
+
+// wyhash-class hash for byte strings; long inputs switch to a striped,
+// SIMD-friendly accumulator. Accepts anything convertible to string_view.
+class StringHash {
+ public:
+  using is_transparent = void;
+
+  explicit StringHash(uint64_t seed = 0) : seed_(seed) {}
+
+  size_t operator()(std::string_view key) const {
+    auto data = reinterpret_cast<const unsigned char *>(key.data());
+    if (key.size() >= hash_internal::kLongInput) {
+      return static_cast<size_t>(
+          hash_internal::LongHash(data, key.size(), seed_));
+    }
+    return static_cast<size_t>(
+        hash_internal::ShortHash(data, key.size(), seed_));
+  }
+
+  void reseed(uint64_t seed) {
+    seed_ = seed;
+  }
+
+ private:
+  uint64_t seed_;
+};
+
+template <class KeyType>
+constexpr bool kIsIntegerKey = std::is_integral<KeyType>::value ||
+                               std::is_enum<KeyType>::value ||
+                               std::is_pointer<KeyType>::value;
+
+// Hash used by HashMap when none is given.
+template <class KeyType, class = void>
+struct DefaultHash : std::hash<KeyType> {};
+
+template <class KeyType>
+struct DefaultHash<KeyType, std::enable_if_t<kIsIntegerKey<KeyType>>>
+    : IntegerHash<KeyType> {
+  using IntegerHash<KeyType>::IntegerHash;
+};
+
+template <>
+struct DefaultHash<std::string> : StringHash {
+  using StringHash::StringHash;
+};
+
+template <>
+struct DefaultHash<std::string_view> : StringHash {
+  using StringHash::StringHash;
+};
@@ -1,253 +1,1440 @@
-// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
-#pragma once
-
-#include <initializer_list>
-#include <functional>
-#include <list>
-#include <stdexcept>
-#include <utility>
-#include <vector>
-
-template <class KeyType, class ValueType, class Hash = std::hash<KeyType>>
-class HashMap {
-  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
-  using BucketList = std::list<typename std::list<ConstKeyValuePair>::iterator>;
-  using BucketListIterator = typename BucketList::const_iterator;
-
- public:
-  using iterator = typename std::list<ConstKeyValuePair>::iterator;
-  using const_iterator = typename std::list<ConstKeyValuePair>::const_iterator;
-
-  HashMap(const Hash &hash = Hash());
-
-  template <class ContainerIterator>
-  HashMap(ContainerIterator begin, ContainerIterator end,
-          const Hash &hash = Hash());
-
-  HashMap(std::initializer_list<ConstKeyValuePair> initial,
-          const Hash &hash = Hash());
-
-  HashMap(const HashMap &other);
-
-  ~HashMap() = default;
-
-  ValueType &operator[](const KeyType key);
-
-  HashMap &operator=(const HashMap &other);
-
-  const ValueType &at(const KeyType key) const;
-
-  void insert(const ConstKeyValuePair elem);
-
-  void erase(const KeyType key);
-
-  iterator find(const KeyType key);
-
-  const_iterator find(const KeyType key) const;
-
-  iterator begin() {
-    return element_list_.begin();
-  }
-
-  const_iterator begin() const {
-    return element_list_.cbegin();
-  }
-
-  iterator end() {
-    return element_list_.end();
-  }
-
-  const_iterator end() const {
-    return element_list_.cend();
-  }
-
-  bool empty() const {
-    return size_ == 0;
-  }
-
-  size_t size() const {
-    return size_;
-  }
-
-  Hash hash_function() const {
-    return hasher_;
-  }
-
-  void clear();
-
- private:
-  const int kLoadFactor_ = 2;  // min table_size_/cardinality
-  const size_t initialSize_ = 2;
-
-  bool IsEqual(const KeyType key, const KeyType other) const {
-    return key == other;
-  }
-
-  size_t IdxFromKey(const KeyType key) const {
-    return hasher_(key) & (table_size_ - 1);
-  }
-
-  BucketListIterator RecordInMap(const KeyType key) const;
-
-  void DoubleSize();
-
-  size_t size_ = 0;  // cardinality
-  size_t table_size_ = initialSize_;
-  std::vector<BucketList> hash_map_ = {};
-  std::list<ConstKeyValuePair> element_list_ = {};
-  Hash hasher_;
-};
-
-template <class KeyType, class ValueType, class Hash>
-HashMap<KeyType, ValueType, Hash>::HashMap(const Hash &hash) : hasher_(hash) {
-  hash_map_.resize(table_size_);
-}
-
-template <class KeyType, class ValueType, class Hash>
-template <class ContainerIterator>
-HashMap<KeyType, ValueType, Hash>::HashMap(ContainerIterator begin,
-                                           ContainerIterator end,
-                                           const Hash &hash)
-    : hasher_(hash) {
-  hash_map_.resize(table_size_);
-  for (auto element = begin; element != end; ++element) {
-    insert(*element);
-  }
-}
-
-template <class KeyType, class ValueType, class Hash>
-HashMap<KeyType, ValueType, Hash>::HashMap(const HashMap &other)
-    : hasher_(other.hash_function()) {
-  hash_map_.resize(table_size_);
-  for (auto element : other) {
-    insert(element);
-  }
-}
-
-template <class KeyType, class ValueType, class Hash>
-HashMap<KeyType, ValueType, Hash>::HashMap(
-    std::initializer_list<ConstKeyValuePair> initial, const Hash &hash)
-    : hasher_(hash) {
-  hash_map_.resize(table_size_);
-  for (auto element : initial) {
-    insert(element);
-  }
-}
-
-template <class KeyType, class ValueType, class Hash>
-ValueType& HashMap<KeyType, ValueType, Hash>::operator[](const KeyType key) {
-  iterator it = find(key);
-  if (it != end()) {
-    return it->second;
-  }
-  std::pair<KeyType, ValueType> new_element = {key, ValueType {}};
-  insert(new_element);
-  return find(key)->second;
-}
-
-template <class KeyType, class ValueType, class Hash>
-HashMap<KeyType, ValueType, Hash>& HashMap<KeyType, ValueType, Hash>::
-operator=(const HashMap &other) {
-  if (this != &other) {
-    size_ = 0;
-    hasher_ = other.hash_function();
-    table_size_ = initialSize_;
-    hash_map_.resize(table_size_);
-    clear();
-    for (auto element : other) {
-      insert(element);
-    }
-  }
-  return *this;
-}
-
-template <class KeyType, class ValueType, class Hash>
-auto HashMap<KeyType, ValueType, Hash>::find(KeyType key) -> iterator {
-  size_t idx = IdxFromKey(key);
-  BucketListIterator bucket_list_iterator = RecordInMap(key);
-  if (bucket_list_iterator != hash_map_[idx].end()) {
-    return *bucket_list_iterator;
-  }
-  return end();
-}
-
-template <class KeyType, class ValueType, class Hash>
-auto HashMap<KeyType, ValueType, Hash>::find(const KeyType key) const
--> const_iterator {
-  size_t idx = IdxFromKey(key);
-  BucketListIterator bucket_list_iterator = RecordInMap(key);
-  if (bucket_list_iterator != hash_map_[idx].end()) {
-    return *bucket_list_iterator;
-  }
-  return end();
-}
-
-template <class KeyType, class ValueType, class Hash>
-void HashMap<KeyType, ValueType, Hash>::clear() {
-  size_ = 0;
-  table_size_ = initialSize_;
-  hash_map_.clear();
-  element_list_.clear();
-  hash_map_.resize(table_size_);
-}
-
-template <class KeyType, class ValueType, class Hash>
-void HashMap<KeyType, ValueType, Hash>::erase(const KeyType key) {
-  BucketListIterator bucket_list_iterator = RecordInMap(key);
-  size_t idx = IdxFromKey(key);
-  if (bucket_list_iterator != hash_map_[idx].end()) {
-    element_list_.erase(*bucket_list_iterator);
-    hash_map_[IdxFromKey(key)].erase(bucket_list_iterator);
-    --size_;
-  }
-}
-
-template <class KeyType, class ValueType, class Hash>
-void HashMap<KeyType, ValueType, Hash>::insert(const ConstKeyValuePair elem) {
-  if (size_ * kLoadFactor_ >= table_size_) {
-    DoubleSize();
-  }
-  size_t idx = IdxFromKey(elem.first);
-  if (find(elem.first) == end()) {
-    element_list_.push_front(elem);
-    hash_map_[idx].push_back(element_list_.begin());
-    ++size_;
-  }
-}
-
-template <class KeyType, class ValueType, class Hash>
-const ValueType &HashMap<KeyType, ValueType, Hash>::
-at(const KeyType key) const {
-  const_iterator it = find(key);
-  if (it != end()) {
-    return it->second;
-  }
-  throw std::out_of_range("Bad request");
-}
-
-template <class KeyType, class ValueType, class Hash>
-auto HashMap<KeyType, ValueType, Hash>::RecordInMap(const KeyType key) const
--> BucketListIterator {
-  size_t idx = IdxFromKey(key);
-  BucketListIterator it;
-  for (it = hash_map_[idx].begin(); it != hash_map_[idx].end(); ++it) {
-    if (IsEqual((*it)->first, key)) {
-      return it;
-    }
-  }
-  return it;
-}
-
-template <class KeyType, class ValueType, class Hash>
-void HashMap<KeyType, ValueType, Hash>::DoubleSize() {
-  table_size_ <<= 1;
-  size_ = 0;
-  hash_map_.clear();
-  hash_map_.resize(table_size_);
-  for (iterator elem = element_list_.begin(); elem != element_list_.end();
-  ++elem) {
-    size_t idx = IdxFromKey(elem->first);
-    hash_map_[idx].push_back(elem);
-    ++size_;
-  }
-}
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash_functions.h"
+#include "hash_map_growth.h"
+#include "hash_map_parallel.h"
+#include "hash_map_stats.h"
+#include "hash_map_trace.h"
+
+// A default hasher providing reseed(uint64_t) (see hash_functions.h) is
+// given a random seed; a hasher passed in keeps its seed, and copies of a
+// map share it.
+//
+// Maps holding at most SmallSize entries allocate no bucket table: lookups
+// scan element_list_ directly and the table is built on the first insert
+// past that size.
+//
+// Stats is NoStats or CollectStats (see hash_map_stats.h); with CollectStats
+// stats() reports operation counts, probe lengths and resize times.
+//
+// Listener receives resize and long-probe events (see hash_map_trace.h).
+//
+// GrowthPolicy picks the table sizes and maps hashes to buckets (see
+// hash_map_growth.h).
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>, size_t SmallSize = 8,
+          class Stats = NoStats, class Listener = NoListener,
+          class GrowthPolicy = PowerOfTwoGrowth>
+class HashMap {
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+  struct Node;
+  using ElementList = std::list<Node>;
+  using ElementIterator = typename ElementList::iterator;
+
+  // The function giving the value of a new entry; Node calls it only when
+  // the entry is constructed.
+  template <class Init>
+  struct InitWith {
+    Init &init;
+  };
+
+  // Selects the upsert() overloads taking a function for the initial value.
+  template <class Init>
+  using IfInitFunction =
+      std::enable_if_t<std::is_invocable_r<ValueType, Init &>::value, bool>;
+
+  // An entry is a single element_list_ node; buckets are chains threaded
+  // through the nodes themselves, so no per-entry bucket allocation is needed.
+  // The hash is kept so that growing never calls the hasher again.
+  struct Node {
+    Node(const ConstKeyValuePair &elem, size_t hash)
+        : value(elem), hash(hash) {}
+
+    // The value is value-initialized in place.
+    Node(size_t hash, const KeyType &key)
+        : value(std::piecewise_construct, std::forward_as_tuple(key),
+                std::forward_as_tuple()),
+          hash(hash) {}
+
+    template <class Init>
+    Node(size_t hash, const KeyType &key, InitWith<Init> init)
+        : value(key, init.init()), hash(hash) {}
+
+    ConstKeyValuePair value;
+    size_t hash;
+    ElementIterator bucket_next;  // element_list_.end() terminates the chain
+  };
+
+  template <class ListIterator, class Value>
+  class NodeIterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = ConstKeyValuePair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value *;
+    using reference = Value &;
+
+    NodeIterator() = default;
+
+    explicit NodeIterator(ListIterator it) : it_(it) {}
+
+    template <class OtherIterator, class OtherValue,
+              class = std::enable_if_t<
+                  std::is_convertible<OtherIterator, ListIterator>::value>>
+    NodeIterator(const NodeIterator<OtherIterator, OtherValue> &other)
+        : it_(other.it_) {}
+
+    reference operator*() const {
+      return it_->value;
+    }
+
+    pointer operator->() const {
+      return &it_->value;
+    }
+
+    NodeIterator &operator++() {
+      ++it_;
+      return *this;
+    }
+
+    NodeIterator operator++(int) {
+      NodeIterator copy = *this;
+      ++it_;
+      return copy;
+    }
+
+    NodeIterator &operator--() {
+      --it_;
+      return *this;
+    }
+
+    NodeIterator operator--(int) {
+      NodeIterator copy = *this;
+      --it_;
+      return copy;
+    }
+
+    friend bool operator==(const NodeIterator &lhs, const NodeIterator &rhs) {
+      return lhs.it_ == rhs.it_;
+    }
+
+    friend bool operator!=(const NodeIterator &lhs, const NodeIterator &rhs) {
+      return lhs.it_ != rhs.it_;
+    }
+
+   private:
+    template <class, class>
+    friend class NodeIterator;
+    friend class HashMap;
+
+    ListIterator it_;
+  };
+
+ public:
+  using iterator = NodeIterator<ElementIterator, ConstKeyValuePair>;
+  using const_iterator = NodeIterator<typename ElementList::const_iterator,
+                                      const ConstKeyValuePair>;
+
+  // Owns an entry removed by extract(). The entry stays in its list node, so
+  // moving it into another map neither allocates nor copies the pair.
+  class node_type {
+   public:
+    node_type() = default;
+    node_type(node_type &&) = default;
+    node_type &operator=(node_type &&) = default;
+
+    bool empty() const {
+      return node_.empty();
+    }
+
+    explicit operator bool() const {
+      return !empty();
+    }
+
+    const KeyType &key() const {
+      return node_.front().value.first;
+    }
+
+    ValueType &mapped() const {
+      return node_.front().value.second;
+    }
+
+   private:
+    friend class HashMap;
+
+    mutable ElementList node_;
+  };
+
+  struct insert_return_type {
+    iterator position;
+    bool inserted;
+    node_type node;
+  };
+
+  HashMap(const Hash &hash = RandomlySeededHash<Hash>(),
+          const KeyEqual &equal = KeyEqual());
+
+  template <class ContainerIterator>
+  HashMap(ContainerIterator begin, ContainerIterator end,
+          const Hash &hash = RandomlySeededHash<Hash>(),
+          const KeyEqual &equal = KeyEqual());
+
+  HashMap(std::initializer_list<ConstKeyValuePair> initial,
+          const Hash &hash = RandomlySeededHash<Hash>(),
+          const KeyEqual &equal = KeyEqual());
+
+  HashMap(const HashMap &other);
+
+  ~HashMap() = default;
+
+  ValueType &operator[](const KeyType &key) {
+    bool inserted;
+    return FindOrEmplace(key, nullptr, &inserted)->value.second;
+  }
+
+  HashMap &operator=(const HashMap &other);
+
+  const ValueType &at(const KeyType &key) const;
+
+  void insert(const ConstKeyValuePair &elem);
+
+  // `hash` must equal hash_function()(elem.first); the key is not rehashed.
+  // Inserts through this and the other precomputed-hash overloads never
+  // trigger the max_chain_length() reseed, so the caller's hashes stay
+  // valid; a reseed by any other call invalidates them.
+  void insert_with_hash(const ConstKeyValuePair &elem, size_t hash);
+
+  // Calls update(value) on the value of `key`, or inserts `key` with the
+  // value init() returns if it is absent; init is called only then. Returns
+  // true if it inserted.
+  template <class Update, class Init>
+  IfInitFunction<Init> upsert(const KeyType &key, Update update, Init init);
+
+  template <class Update>
+  bool upsert(const KeyType &key, Update update, const ValueType &init) {
+    return upsert(key, update, [&init]() -> const ValueType & {
+      return init;
+    });
+  }
+
+  // `hash` must equal hash_function()(key); the key is not rehashed.
+  template <class Update, class Init>
+  IfInitFunction<Init> upsert(const KeyType &key, size_t hash, Update update,
+                              Init init);
+
+  template <class Update>
+  bool upsert(const KeyType &key, size_t hash, Update update,
+              const ValueType &init) {
+    return upsert(key, hash, update, [&init]() -> const ValueType & {
+      return init;
+    });
+  }
+
+  // Calls fn(value) on the value of `key`, value-initialized in place if the
+  // key is absent, so compute(key, [](int &n) { ++n; }) counts.
+  template <class Fn>
+  ValueType &compute(const KeyType &key, Fn fn);
+
+  void erase(const KeyType &key);
+
+  // Returns the entry that followed `pos`. Only the bucket of `pos` is
+  // walked; the key is not hashed again.
+  iterator erase(const_iterator pos);
+
+  iterator erase(iterator pos) {
+    return erase(const_iterator(pos));
+  }
+
+  iterator erase(const_iterator first, const_iterator last);
+
+  // Erases the entries matching `pred` and returns how many there were.
+  // Chains are walked once with their links at hand, so each unlink is O(1).
+  template <class Predicate>
+  size_t erase_if(Predicate pred);
+
+  node_type extract(const_iterator pos);
+
+  // Returns an empty handle if there is no such key.
+  node_type extract(const KeyType &key);
+
+  // On a duplicate key the handle is given back in the result.
+  insert_return_type insert(node_type &&node);
+
+  // Moves every entry whose key is not in this map out of `source`.
+  void merge(HashMap &source);
+
+  iterator find(const KeyType &key);
+
+  const_iterator find(const KeyType &key) const;
+
+  // Lookups with a hash computed by hash_function() beforehand.
+  iterator find(const KeyType &key, size_t hash);
+
+  const_iterator find(const KeyType &key, size_t hash) const;
+
+  bool contains(const KeyType &key) const {
+    return find(key) != end();
+  }
+
+  // Prefetching for batched lookups, which hash a run of keys before
+  // probing them. A probe misses twice, on the bucket slot and on the first
+  // entry of its chain, and the entry's address is in the slot, so the two
+  // are prefetched in turn: prefetch_bucket() for a key 2d probes ahead
+  // starts loading its slot without waiting for it, and prefetch() for the
+  // key d ahead reads that slot, by then cached, and starts loading the
+  // entry. prefetch() alone stalls on the slot and hides only the second
+  // miss.
+  void prefetch_bucket(size_t hash) const;
+
+  void prefetch(size_t hash) const;
+
+  iterator begin() {
+    return iterator(element_list_.begin());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(element_list_.cbegin());
+  }
+
+  iterator end() {
+    return iterator(element_list_.end());
+  }
+
+  const_iterator end() const {
+    return const_iterator(element_list_.cend());
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  Hash hash_function() const {
+    return hasher_;
+  }
+
+  KeyEqual key_eq() const {
+    return key_equal_;
+  }
+
+  // Calls fn(entry) for every entry on up to `threads` threads, 0 meaning
+  // one per core. Threads take whole bucket ranges, so fn runs concurrently
+  // only on different entries; it must not insert or erase.
+  template <class Fn>
+  void parallel_for_each(Fn fn, size_t threads = 0);
+
+  template <class Fn>
+  void parallel_for_each(Fn fn, size_t threads = 0) const;
+
+  // Folds map_fn(entry) of every entry into `init` with combine_fn, on
+  // threads as parallel_for_each() does. Each bucket range is folded on its
+  // own and the results are combined in bucket order, so for an associative
+  // combine_fn the result does not depend on the thread count or timing.
+  // Bucket order follows the hasher's seed, so unless combine_fn is also
+  // commutative, two maps with the same entries may fold differently.
+  template <class T, class MapFn, class CombineFn>
+  T parallel_reduce(T init, MapFn map_fn, CombineFn combine_fn,
+                    size_t threads = 0) const;
+
+  // With keep_capacity the bucket table is kept for reuse; otherwise it is
+  // freed and the map goes back to the small layout.
+  void clear(bool keep_capacity = false);
+
+  // Rebuilds the table with at least `count` buckets, or fewer if it is
+  // larger than the entries need.
+  void rehash(size_t count);
+
+  // Sizes the table so that `count` entries fit without growing.
+  void reserve(size_t count);
+
+  // Shrinks the table to the smallest size for the current entries and
+  // frees it altogether if they fit in the small layout.
+  void shrink_to_fit();
+
+  // Erasing halves the table while the load factor is below `factor`.
+  // It must be under half the growth threshold, so that a halved table is
+  // not grown again by the next insert. 0 (the default) disables shrinking.
+  void set_min_load_factor(double factor);
+
+  double min_load_factor() const {
+    return min_load_factor_;
+  }
+
+  // Moves the entry to the start of the iteration order in O(1). Iterators
+  // stay valid; LruHashMap keeps recency this way.
+  void move_to_front(const_iterator pos) {
+    element_list_.splice(element_list_.begin(), element_list_, pos.it_);
+  }
+
+  // Moves the entry at `pos` to just before `next` in the iteration order,
+  // in O(1). Iterators stay valid.
+  void move_before(const_iterator pos, const_iterator next) {
+    element_list_.splice(next.it_, element_list_, pos.it_);
+  }
+
+  // Switches the hasher to `seed` and rebuilds the buckets. Hashes obtained
+  // from an earlier hash_function() are no longer valid afterwards.
+  void reseed(uint64_t seed);
+
+  // HashDoS defense: an insert that makes a chain longer than `limit`
+  // reseeds the hasher with a random seed and rehashes, at most once per
+  // table size. 0 disables it; other limits below 8 throw, as random
+  // hashing exceeds them at the table's load factor.
+  void set_max_chain_length(size_t limit);
+
+  size_t max_chain_length() const {
+    return max_chain_length_;
+  }
+
+  // Available with Stats = CollectStats.
+  HashMapStats stats() const;
+
+  void reset_stats() {
+    stats_.Reset();
+  }
+
+  Listener &listener() {
+    return listener_;
+  }
+
+  const Listener &listener() const {
+    return listener_;
+  }
+
+  // Bucket interface. A small map has no table yet; it reports the table
+  // Grow() builds once the map outgrows SmallSize, and the buckets its
+  // entries will occupy there.
+  size_t bucket_count() const {
+    return ReportedTableSize();
+  }
+
+  size_t bucket(const KeyType &key) const {
+    return ReportedGrowth().Index(hasher_(key));
+  }
+
+  size_t bucket_size(size_t n) const;
+
+  double load_factor() const {
+    return static_cast<double>(size_) / ReportedTableSize();
+  }
+
+  // Element k is the number of buckets holding exactly k entries.
+  std::vector<size_t> bucket_histogram() const;
+
+  HashQualityReport hash_quality() const;
+
+  // Memory requested for the table and the entries. Chains are threaded
+  // through the element nodes, so there are no separate bucket nodes.
+  HashMapMemoryUsage memory_usage() const;
+
+ private:
+  const int kLoadFactor_ = 2;  // min table_size_/cardinality
+  const size_t initialSize_ = 2;
+  const size_t parallelChunk_ = 4096;  // buckets per parallel task
+  const size_t kMinChainLimit_ = 8;  // smallest nonzero max_chain_length_
+
+  bool IsEqual(const KeyType &key, const KeyType &other) const {
+    return key_equal_(key, other);
+  }
+
+  size_t IdxFromHash(size_t hash) const {
+    return growth_.Index(hash);
+  }
+
+  bool IsSmall() const {
+    return hash_map_.empty();
+  }
+
+  // The table size and bucket mapping seen by the bucket interface.
+  size_t ReportedTableSize() const;
+
+  GrowthPolicy ReportedGrowth() const {
+    return IsSmall() ? GrowthPolicy(ReportedTableSize()) : growth_;
+  }
+
+  void SetTableSize(size_t size) {
+    table_size_ = size;
+    growth_ = GrowthPolicy(size);
+  }
+
+  void Insert(const ConstKeyValuePair &elem, size_t hash, bool may_reseed);
+
+  ElementIterator RecordInMap(const KeyType &key, size_t hash,
+                              size_t *chain_length = nullptr) const;
+
+  ElementIterator RecordInList(const KeyType &key,
+                               size_t *probes = nullptr) const;
+
+  // Bucket ranges of parallelChunk_ buckets; a small map is one range.
+  size_t ParallelChunks() const {
+    return IsSmall() ? 1 : (table_size_ + parallelChunk_ - 1) / parallelChunk_;
+  }
+
+  // Calls fn(node) for the nodes of bucket range `chunk`.
+  template <class Fn>
+  void VisitChunk(size_t chunk, Fn fn) const;
+
+  // Finds `key` or inserts it with a value-initialized value, or with the
+  // value of an InitWith passed in `args`. The key is looked up once and
+  // hashed at most once: `hash` points to its hash or is null, and a small
+  // map hashes only to insert.
+  template <class... Args>
+  ElementIterator FindOrEmplace(const KeyType &key, const size_t *hash,
+                                bool *inserted, Args &&... args);
+
+  size_t MaxBucketLength() const;
+
+  std::vector<size_t> BucketSizes() const;
+
+  void LinkToBucket(ElementIterator node);
+
+  void UnlinkFromBucket(ElementIterator node);
+
+  // Splices `node` out of `from` to the front of element_list_, growing the
+  // table first if needed. node->hash must be set by hasher_. A chain_length
+  // of 0 skips the max_chain_length_ check, as the precomputed-hash paths
+  // must not reseed.
+  void AttachNode(ElementList *from, ElementIterator node,
+                  size_t chain_length);
+
+  // Takes `node` out of the buckets and the count; it stays in element_list_
+  // and must leave it before the table is rebuilt.
+  void DetachNode(ElementIterator node);
+
+  // Applies min_load_factor_ after entries were removed.
+  void ShrinkIfSparse();
+
+  void Rehash();
+
+  // Replaces the entries with copies of other's, in the same order and with
+  // the same table size. Cached hashes are reused, so the hasher must end up
+  // equal to other's.
+  void CopyEntries(const HashMap &other);
+
+  // Rebuilds the table at `new_size` buckets, notifying stats_ and listener_.
+  void Resize(size_t new_size);
+
+  // Grows the table until the entries fit under kLoadFactor_.
+  void Grow();
+
+  size_t size_ = 0;  // cardinality
+  size_t table_size_ = initialSize_;
+  GrowthPolicy growth_{initialSize_};
+  std::vector<ElementIterator> hash_map_ = {};  // chain heads, empty if small
+  ElementList element_list_ = {};
+  Hash hasher_;
+  KeyEqual key_equal_;
+  size_t max_chain_length_ = 0;
+  bool reseeded_ = false;  // since the last Resize()
+  double min_load_factor_ = 0;
+  [[no_unique_address]] mutable Stats stats_;
+  [[no_unique_address]] mutable Listener listener_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy,
+          class Predicate>
+size_t erase_if(HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                        Listener, GrowthPolicy> &map,
+                Predicate pred) {
+  return map.erase_if(pred);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+        GrowthPolicy>::HashMap(const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class ContainerIterator>
+HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+        GrowthPolicy>::HashMap(ContainerIterator begin, ContainerIterator end,
+                               const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (auto element = begin; element != end; ++element) {
+    insert(*element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+        GrowthPolicy>::HashMap(const HashMap &other)
+    : hasher_(other.hash_function()),
+      key_equal_(other.key_eq()),
+      max_chain_length_(other.max_chain_length_),
+      min_load_factor_(other.min_load_factor_) {
+  CopyEntries(other);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+        GrowthPolicy>::HashMap(std::initializer_list<ConstKeyValuePair> initial,
+                               const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (auto element : initial) {
+    insert(element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::operator=(const HashMap &other) -> HashMap & {
+  if (this != &other) {
+    CopyEntries(other);
+    hasher_ = other.hash_function();
+    key_equal_ = other.key_eq();
+    max_chain_length_ = other.max_chain_length_;
+    min_load_factor_ = other.min_load_factor_;
+  }
+  return *this;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::find(const KeyType &key) -> iterator {
+  if (IsSmall()) {
+    size_t probes = 0;
+    ElementIterator it = RecordInList(key, &probes);
+    stats_.OnFind(probes, it != element_list_.end());
+    return iterator(it);
+  }
+  return find(key, hasher_(key));
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::find(const KeyType &key) const -> const_iterator {
+  if (IsSmall()) {
+    size_t probes = 0;
+    ElementIterator it = RecordInList(key, &probes);
+    stats_.OnFind(probes, it != element_list_.end());
+    return const_iterator(it);
+  }
+  return find(key, hasher_(key));
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::find(const KeyType &key, size_t hash) -> iterator {
+  size_t probes = 0;
+  ElementIterator it = RecordInMap(key, hash, &probes);
+  stats_.OnFind(probes, it != element_list_.end());
+  return iterator(it);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::find(const KeyType &key,
+                                 size_t hash) const -> const_iterator {
+  size_t probes = 0;
+  ElementIterator it = RecordInMap(key, hash, &probes);
+  stats_.OnFind(probes, it != element_list_.end());
+  return const_iterator(it);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::prefetch_bucket(size_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+  if (!IsSmall()) {
+    __builtin_prefetch(&hash_map_[IdxFromHash(hash)]);
+  }
+#else
+  (void)hash;
+#endif
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::prefetch(size_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+  if (!IsSmall()) {
+    ElementIterator head = hash_map_[IdxFromHash(hash)];
+    if (head != element_list_.end()) {
+      __builtin_prefetch(&*head);
+    }
+  }
+#else
+  (void)hash;
+#endif
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::clear(bool keep_capacity) {
+  size_ = 0;
+  element_list_.clear();
+  if (keep_capacity) {
+    std::fill(hash_map_.begin(), hash_map_.end(), element_list_.end());
+  } else {
+    SetTableSize(initialSize_);
+    std::vector<ElementIterator>().swap(hash_map_);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::shrink_to_fit() {
+  if (size_ > SmallSize) {
+    rehash(0);
+  } else if (!IsSmall()) {
+    SetTableSize(initialSize_);
+    std::vector<ElementIterator>().swap(hash_map_);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::set_min_load_factor(double factor) {
+  if (factor < 0 || factor * 2 >= 1.0 / kLoadFactor_) {
+    throw std::invalid_argument("min load factor out of range");
+  }
+  min_load_factor_ = factor;
+  ShrinkIfSparse();
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::rehash(size_t count) {
+  Resize(GrowthPolicy::RoundUp(
+      std::max({initialSize_, count, size_ * kLoadFactor_ + 1})));
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::reserve(size_t count) {
+  if (IsSmall() && count <= SmallSize) {
+    return;
+  }
+  rehash(count * kLoadFactor_);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::erase(const KeyType &key) {
+  if (IsSmall()) {
+    ElementIterator node = RecordInList(key);
+    if (node != element_list_.end()) {
+      element_list_.erase(node);
+      --size_;
+      stats_.OnErase();
+    }
+    return;
+  }
+  size_t hash = hasher_(key);
+  ElementIterator *link = &hash_map_[IdxFromHash(hash)];
+  for (; *link != element_list_.end(); link = &(*link)->bucket_next) {
+    if ((*link)->hash == hash && IsEqual((*link)->value.first, key)) {
+      ElementIterator node = *link;
+      *link = node->bucket_next;
+      element_list_.erase(node);
+      --size_;
+      stats_.OnErase();
+      ShrinkIfSparse();
+      return;
+    }
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::erase(const_iterator pos) -> iterator {
+  ElementIterator node = element_list_.erase(pos.it_, pos.it_);
+  DetachNode(node);
+  iterator next(element_list_.erase(node));
+  ShrinkIfSparse();
+  return next;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::erase(const_iterator first,
+                                  const_iterator last) -> iterator {
+  while (first != last) {
+    first = erase(first);
+  }
+  return iterator(element_list_.erase(last.it_, last.it_));
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Predicate>
+size_t HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+               GrowthPolicy>::erase_if(Predicate pred) {
+  size_t erased = 0;
+  if (IsSmall()) {
+    for (ElementIterator it = element_list_.begin();
+         it != element_list_.end();) {
+      if (pred(std::as_const(it->value))) {
+        it = element_list_.erase(it);
+        ++erased;
+        stats_.OnErase();
+      } else {
+        ++it;
+      }
+    }
+  } else {
+    for (ElementIterator &head : hash_map_) {
+      ElementIterator *link = &head;
+      while (*link != element_list_.end()) {
+        ElementIterator node = *link;
+        if (pred(std::as_const(node->value))) {
+          *link = node->bucket_next;
+          element_list_.erase(node);
+          ++erased;
+          stats_.OnErase();
+        } else {
+          link = &node->bucket_next;
+        }
+      }
+    }
+  }
+  size_ -= erased;
+  ShrinkIfSparse();
+  return erased;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Fn>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::parallel_for_each(Fn fn, size_t threads) {
+  parallel_internal::RunChunks(ParallelChunks(), threads, [&](size_t chunk) {
+    VisitChunk(chunk, [&](Node &node) { fn(node.value); });
+  });
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Fn>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::parallel_for_each(Fn fn, size_t threads) const {
+  parallel_internal::RunChunks(ParallelChunks(), threads, [&](size_t chunk) {
+    VisitChunk(chunk, [&](const Node &node) { fn(node.value); });
+  });
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class T, class MapFn, class CombineFn>
+T HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+          GrowthPolicy>::parallel_reduce(T init, MapFn map_fn,
+                                         CombineFn combine_fn,
+                                         size_t threads) const {
+  // Ranges start from their first entry rather than an identity element.
+  std::vector<std::optional<T>> partial(ParallelChunks());
+  parallel_internal::RunChunks(partial.size(), threads, [&](size_t chunk) {
+    std::optional<T> &result = partial[chunk];
+    VisitChunk(chunk, [&](const Node &node) {
+      if (result) {
+        result = combine_fn(std::move(*result), map_fn(node.value));
+      } else {
+        result.emplace(map_fn(node.value));
+      }
+    });
+  });
+  for (std::optional<T> &result : partial) {
+    if (result) {
+      init = combine_fn(std::move(init), std::move(*result));
+    }
+  }
+  return init;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::insert(const ConstKeyValuePair &elem) {
+  Insert(elem, hasher_(elem.first), true);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::insert_with_hash(const ConstKeyValuePair &elem,
+                                             size_t hash) {
+  Insert(elem, hash, false);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::Insert(const ConstKeyValuePair &elem, size_t hash,
+                                   bool may_reseed) {
+  size_t chain_length = 0;
+  if (RecordInMap(elem.first, hash, &chain_length) != element_list_.end()) {
+    return;
+  }
+  ElementList node;
+  node.emplace_front(elem, hash);
+  AttachNode(&node, node.begin(), may_reseed ? chain_length : 0);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Update, class Init>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::upsert(const KeyType &key, Update update,
+                                   Init init) -> IfInitFunction<Init> {
+  bool inserted;
+  ElementIterator it =
+      FindOrEmplace(key, nullptr, &inserted, InitWith<Init>{init});
+  if (!inserted) {
+    update(it->value.second);
+  }
+  return inserted;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Update, class Init>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::upsert(const KeyType &key, size_t hash,
+                                   Update update, Init init)
+    -> IfInitFunction<Init> {
+  bool inserted;
+  ElementIterator it =
+      FindOrEmplace(key, &hash, &inserted, InitWith<Init>{init});
+  if (!inserted) {
+    update(it->value.second);
+  }
+  return inserted;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Fn>
+ValueType &HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                   Listener, GrowthPolicy>::compute(const KeyType &key, Fn fn) {
+  bool inserted;
+  ValueType &value = FindOrEmplace(key, nullptr, &inserted)->value.second;
+  fn(value);
+  return value;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::insert(node_type &&node) -> insert_return_type {
+  if (node.empty()) {
+    return {end(), false, node_type()};
+  }
+  ElementIterator elem = node.node_.begin();
+  elem->hash = hasher_(elem->value.first);
+  size_t chain_length = 0;
+  ElementIterator found = RecordInMap(elem->value.first, elem->hash,
+                                      &chain_length);
+  if (found != element_list_.end()) {
+    return {iterator(found), false, std::move(node)};
+  }
+  AttachNode(&node.node_, elem, chain_length);
+  return {iterator(elem), true, node_type()};
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::extract(const_iterator pos) -> node_type {
+  ElementIterator node = element_list_.erase(pos.it_, pos.it_);
+  DetachNode(node);
+  node_type handle;
+  handle.node_.splice(handle.node_.begin(), element_list_, node);
+  ShrinkIfSparse();
+  return handle;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::extract(const KeyType &key) -> node_type {
+  const_iterator it = find(key);
+  if (it == end()) {
+    return node_type();
+  }
+  return extract(it);
+}
+
+// Nodes are rehashed with this map's hasher but never reallocated.
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::merge(HashMap &source) {
+  if (&source == this) {
+    return;
+  }
+  ElementIterator it = source.element_list_.begin();
+  while (it != source.element_list_.end()) {
+    ElementIterator node = it++;
+    size_t hash = hasher_(node->value.first);
+    size_t chain_length = 0;
+    if (RecordInMap(node->value.first, hash, &chain_length) ==
+        element_list_.end()) {
+      source.DetachNode(node);
+      node->hash = hash;
+      AttachNode(&source.element_list_, node, chain_length);
+    }
+  }
+  source.ShrinkIfSparse();
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::AttachNode(ElementList *from, ElementIterator node,
+                                       size_t chain_length) {
+  bool resized = false;
+  if (IsSmall() ? size_ >= SmallSize : size_ * kLoadFactor_ >= table_size_) {
+    Grow();
+    resized = true;
+  }
+  element_list_.splice(element_list_.begin(), *from, node);
+  if (!IsSmall()) {
+    LinkToBucket(node);
+  }
+  ++size_;
+  stats_.OnInsert();
+  if constexpr (IsSeedableHash<Hash>::value) {
+    if (!resized && !reseeded_ && !IsSmall() && max_chain_length_ != 0 &&
+        chain_length + 1 > max_chain_length_) {
+      reseed(RandomSeed());
+      reseeded_ = true;
+    }
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::DetachNode(ElementIterator node) {
+  if (!IsSmall()) {
+    UnlinkFromBucket(node);
+  }
+  --size_;
+  stats_.OnErase();
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::ShrinkIfSparse() {
+  if (min_load_factor_ == 0 || IsSmall()) {
+    return;
+  }
+  size_t new_size = table_size_;
+  while (size_ < new_size * min_load_factor_) {
+    size_t halved =
+        GrowthPolicy::RoundUp(std::max(initialSize_, new_size / 2));
+    if (halved >= new_size) {
+      break;
+    }
+    new_size = halved;
+  }
+  if (new_size != table_size_) {
+    Resize(new_size);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::reseed(uint64_t seed) {
+  static_assert(IsSeedableHash<Hash>::value,
+                "reseed requires a Hash with reseed(uint64_t)");
+  hasher_.reseed(seed);
+  for (Node &node : element_list_) {
+    node.hash = hasher_(node.value.first);
+  }
+  if (!IsSmall()) {
+    Rehash();
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::set_max_chain_length(size_t limit) {
+  static_assert(IsSeedableHash<Hash>::value,
+                "chain length limit requires a Hash with reseed(uint64_t)");
+  if (limit != 0 && limit < kMinChainLimit_) {
+    throw std::invalid_argument("max chain length too small");
+  }
+  max_chain_length_ = limit;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+const ValueType &HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                         Listener, GrowthPolicy>::at(const KeyType &key) const {
+  const_iterator it = find(key);
+  if (it != end()) {
+    return it->second;
+  }
+  throw std::out_of_range("Bad request");
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::RecordInMap(const KeyType &key, size_t hash,
+                                        size_t *chain_length) const
+    -> ElementIterator {
+  size_t probes = 0;
+  ElementIterator it;
+  if (IsSmall()) {
+    it = const_cast<ElementList &>(element_list_).begin();
+    for (; it != element_list_.end(); ++it, ++probes) {
+      if (it->hash == hash && IsEqual(it->value.first, key)) {
+        break;
+      }
+    }
+  } else {
+    it = hash_map_[IdxFromHash(hash)];
+    for (; it != element_list_.end(); it = it->bucket_next, ++probes) {
+      if (it->hash == hash && IsEqual(it->value.first, key)) {
+        break;
+      }
+    }
+    if constexpr (Listener::kEnabled) {
+      if (probes > listener_.long_probe_threshold()) {
+        listener_.OnLongProbe(probes, IdxFromHash(hash));
+      }
+    }
+  }
+  if (chain_length != nullptr) {
+    *chain_length = probes;
+  }
+  return it;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::RecordInList(const KeyType &key,
+                                         size_t *probes) const
+    -> ElementIterator {
+  ElementIterator it = const_cast<ElementList &>(element_list_).begin();
+  size_t scanned = 0;
+  for (; it != element_list_.end(); ++it, ++scanned) {
+    if (IsEqual(it->value.first, key)) {
+      break;
+    }
+  }
+  if (probes != nullptr) {
+    *probes = scanned;
+  }
+  return it;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class Fn>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::VisitChunk(size_t chunk, Fn fn) const {
+  if (IsSmall()) {
+    for (Node &node : const_cast<ElementList &>(element_list_)) {
+      fn(node);
+    }
+    return;
+  }
+  size_t last = std::min(table_size_, (chunk + 1) * parallelChunk_);
+  for (size_t idx = chunk * parallelChunk_; idx < last; ++idx) {
+    for (ElementIterator it = hash_map_[idx]; it != element_list_.end();
+         it = it->bucket_next) {
+      fn(*it);
+    }
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+template <class... Args>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::FindOrEmplace(const KeyType &key,
+                                          const size_t *hash, bool *inserted,
+                                          Args &&... args) -> ElementIterator {
+  size_t probes = 0;
+  size_t key_hash = hash != nullptr ? *hash : 0;
+  ElementIterator it;
+  if (IsSmall()) {
+    it = RecordInList(key, &probes);
+  } else {
+    if (hash == nullptr) {
+      key_hash = hasher_(key);
+    }
+    it = RecordInMap(key, key_hash, &probes);
+  }
+  stats_.OnFind(probes, it != element_list_.end());
+  *inserted = it == element_list_.end();
+  if (*inserted) {
+    if (IsSmall() && hash == nullptr) {
+      key_hash = hasher_(key);
+    }
+    ElementList node;
+    node.emplace_front(key_hash, key, std::forward<Args>(args)...);
+    it = node.begin();
+    AttachNode(&node, it, hash == nullptr ? probes : 0);
+  }
+  return it;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::LinkToBucket(ElementIterator node) {
+  size_t idx = IdxFromHash(node->hash);
+  node->bucket_next = hash_map_[idx];
+  hash_map_[idx] = node;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::UnlinkFromBucket(ElementIterator node) {
+  ElementIterator *link = &hash_map_[IdxFromHash(node->hash)];
+  while (*link != node) {
+    link = &(*link)->bucket_next;
+  }
+  *link = node->bucket_next;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::Rehash() {
+  hash_map_.assign(table_size_, element_list_.end());
+  for (ElementIterator elem = element_list_.begin();
+  elem != element_list_.end(); ++elem) {
+    LinkToBucket(elem);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::Resize(size_t new_size) {
+  size_t old_buckets = hash_map_.size();
+  listener_.OnResizeStart(old_buckets, new_size);
+  std::chrono::steady_clock::time_point start;
+  if constexpr (Stats::kEnabled) {
+    start = std::chrono::steady_clock::now();
+  }
+  if (new_size < old_buckets) {
+    std::vector<ElementIterator>().swap(hash_map_);
+  }
+  SetTableSize(new_size);
+  Rehash();
+  reseeded_ = false;
+  if constexpr (Stats::kEnabled) {
+    stats_.OnResize(std::chrono::steady_clock::now() - start);
+  }
+  listener_.OnResizeEnd(old_buckets, new_size);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::CopyEntries(const HashMap &other) {
+  ElementList entries;
+  for (const Node &node : other.element_list_) {
+    entries.emplace_back(node.value, node.hash);
+  }
+  element_list_.swap(entries);
+  size_ = other.size_;
+  SetTableSize(other.table_size_);
+  if (other.IsSmall()) {
+    std::vector<ElementIterator>().swap(hash_map_);
+  } else {
+    Rehash();
+  }
+}
+
+// Also moves a small map to the hashed layout, so the table may grow by more
+// than one step.
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+void HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::Grow() {
+  size_t new_size = table_size_;
+  do {
+    new_size = GrowthPolicy::Grow(new_size);
+  } while (size_ * kLoadFactor_ >= new_size);
+  Resize(new_size);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashMapStats HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                     Listener, GrowthPolicy>::stats() const {
+  static_assert(Stats::kEnabled, "stats() requires Stats = CollectStats");
+  HashMapStats result = stats_.counters();
+  result.max_bucket_length = MaxBucketLength();
+  result.memory_bytes = memory_usage().total_bytes;
+  return result;
+}
+
+// A small map reports the buckets of BucketSizes(), like bucket_size().
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+size_t HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+               GrowthPolicy>::MaxBucketLength() const {
+  if (IsSmall()) {
+    std::vector<size_t> sizes = BucketSizes();
+    return *std::max_element(sizes.begin(), sizes.end());
+  }
+  size_t longest = 0;
+  for (ElementIterator head : hash_map_) {
+    size_t length = 0;
+    for (; head != element_list_.end(); head = head->bucket_next) {
+      ++length;
+    }
+    longest = std::max(longest, length);
+  }
+  return longest;
+}
+
+// A std::list node holds its two links followed by the Node, aligned for
+// the Node.
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashMapMemoryUsage HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                           Listener, GrowthPolicy>::memory_usage() const {
+  constexpr size_t kLinks = 2 * sizeof(void *);
+  constexpr size_t kNodeBytes =
+      (kLinks + alignof(Node) - 1) / alignof(Node) * alignof(Node) +
+      sizeof(Node);
+  HashMapMemoryUsage usage;
+  usage.object_bytes = sizeof(*this);
+  usage.bucket_array_bytes = hash_map_.capacity() * sizeof(ElementIterator);
+  usage.element_node_bytes = size_ * kNodeBytes;
+  usage.allocations = size_ + (hash_map_.capacity() != 0);
+  usage.total_bytes =
+      usage.object_bytes + usage.bucket_array_bytes + usage.element_node_bytes;
+  if (size_ != 0) {
+    usage.bytes_per_entry = static_cast<double>(usage.total_bytes) / size_;
+  }
+  return usage;
+}
+
+// Mirrors Grow() at the insert that takes the map past SmallSize entries.
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+size_t HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+               GrowthPolicy>::ReportedTableSize() const {
+  if (!IsSmall()) {
+    return table_size_;
+  }
+  size_t size = table_size_;
+  do {
+    size = GrowthPolicy::Grow(size);
+  } while (SmallSize * kLoadFactor_ >= size);
+  return size;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+size_t HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+               GrowthPolicy>::bucket_size(size_t n) const {
+  size_t count = 0;
+  if (IsSmall()) {
+    GrowthPolicy growth = ReportedGrowth();
+    for (const Node &node : element_list_) {
+      count += growth.Index(node.hash) == n;
+    }
+    return count;
+  }
+  for (ElementIterator it = hash_map_[n]; it != element_list_.end();
+  it = it->bucket_next) {
+    ++count;
+  }
+  return count;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::BucketSizes() const -> std::vector<size_t> {
+  GrowthPolicy growth = ReportedGrowth();
+  std::vector<size_t> sizes(ReportedTableSize(), 0);
+  for (const Node &node : element_list_) {
+    ++sizes[growth.Index(node.hash)];
+  }
+  return sizes;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+auto HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats, Listener,
+             GrowthPolicy>::bucket_histogram() const -> std::vector<size_t> {
+  std::vector<size_t> histogram;
+  for (size_t size : BucketSizes()) {
+    if (size >= histogram.size()) {
+      histogram.resize(size + 1, 0);
+    }
+    ++histogram[size];
+  }
+  return histogram;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual,
+          size_t SmallSize, class Stats, class Listener, class GrowthPolicy>
+HashQualityReport HashMap<KeyType, ValueType, Hash, KeyEqual, SmallSize, Stats,
+                          Listener, GrowthPolicy>::hash_quality() const {
+  HashQualityReport report;
+  report.bucket_count = bucket_count();
+  report.size = size_;
+  report.load_factor = load_factor();
+  double expected = report.load_factor;
+  for (size_t size : BucketSizes()) {
+    report.max_bucket_size = std::max(report.max_bucket_size, size);
+    report.empty_buckets += size == 0;
+    if (expected > 0) {
+      double diff = size - expected;
+      report.chi_squared += diff * diff / expected;
+    }
+  }
+  double buckets = static_cast<double>(report.bucket_count);
+  report.normalized_chi_squared = report.chi_squared / (buckets - 1);
+  report.expected_empty_buckets =
+      buckets * std::pow(1.0 - 1.0 / buckets, size_);
+  return report;
+}
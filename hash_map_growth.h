@@ -0,0 +1,180 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+// Growth policies for HashMap. A policy is constructed for one table size
+// and maps hashes to buckets of that table:
+//
+//   static size_t RoundUp(size_t count);  // smallest valid size >= count
+//   static size_t Grow(size_t size);      // next valid size above `size`
+//   size_t Index(size_t hash) const;      // bucket in [0, size)
+//
+// Every policy accepts 2, the size of a new map.
+
+namespace growth_internal {
+
+// High 64 bits of a 64x64 multiply.
+inline uint64_t MulHi64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  return static_cast<uint64_t>((static_cast<__uint128_t>(a) * b) >> 64);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a),
+           lb = static_cast<uint32_t>(b);
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t mid = (rl >> 32) + static_cast<uint32_t>(rm0) +
+                 static_cast<uint32_t>(rm1);
+  return rh + (rm0 >> 32) + (rm1 >> 32) + (mid >> 32);
+#endif
+}
+
+// Scales `size` by Num/Den, advancing by at least one.
+template <size_t Num, size_t Den>
+constexpr size_t ScaleUp(size_t size) {
+  static_assert(Den > 0 && Num > Den, "growth factor must exceed 1");
+  size_t scaled = size / Den * Num + size % Den * Num / Den;
+  return scaled > size ? scaled : size + 1;
+}
+
+// The smallest prime >= 2^(i/8) for every i up to 256, so consecutive sizes
+// are about 9% apart and all of them fit in 32 bits.
+constexpr uint32_t kPrimes[] = {
+    2u, 3u, 5u, 7u, 11u, 13u, 17u, 19u, 23u, 29u, 31u, 37u, 41u, 43u, 47u, 53u,
+    59u, 67u, 71u, 79u, 83u, 97u, 101u, 109u, 127u, 131u, 149u, 157u, 167u,
+    191u, 199u, 223u, 239u, 257u, 281u, 307u, 337u, 367u, 397u, 431u, 479u,
+    521u, 563u, 613u, 673u, 727u, 797u, 863u, 941u, 1031u, 1117u, 1223u, 1361u,
+    1451u, 1583u, 1723u, 1879u, 2053u, 2237u, 2437u, 2657u, 2897u, 3163u, 3449u,
+    3761u, 4099u, 4481u, 4871u, 5323u, 5801u, 6317u, 6899u, 7517u, 8209u, 8941u,
+    9743u, 10627u, 11587u, 12637u, 13781u, 15031u, 16411u, 17881u, 19489u,
+    21269u, 23173u, 25301u, 27581u, 30059u, 32771u, 35747u, 38971u, 42499u,
+    46349u, 50539u, 55109u, 60101u, 65537u, 71471u, 77951u, 84991u, 92683u,
+    101081u, 110221u, 120199u, 131101u, 142939u, 155887u, 169987u, 185369u,
+    202183u, 220447u, 240421u, 262147u, 285871u, 311747u, 339959u, 370759u,
+    404291u, 440893u, 480787u, 524309u, 571741u, 623521u, 679919u, 741457u,
+    808579u, 881779u, 961549u, 1048583u, 1143481u, 1246997u, 1359857u, 1482919u,
+    1617137u, 1763491u, 1923107u, 2097169u, 2286961u, 2493949u, 2719699u,
+    2965847u, 3234251u, 3526987u, 3846197u, 4194319u, 4573931u, 4987901u,
+    5439341u, 5931649u, 6468509u, 7053971u, 7692389u, 8388617u, 9147857u,
+    9975803u, 10878709u, 11863289u, 12937007u, 14107921u, 15384821u, 16777259u,
+    18295687u, 19951597u, 21757361u, 23726569u, 25874027u, 28215809u, 30769567u,
+    33554467u, 36591383u, 39903197u, 43514717u, 47453149u, 51748043u, 56431657u,
+    61539113u, 67108879u, 73182743u, 79806341u, 87029471u, 94906297u,
+    103496027u, 112863217u, 123078209u, 134217757u, 146365487u, 159612679u,
+    174058861u, 189812533u, 206992043u, 225726419u, 246156401u, 268435459u,
+    292730989u, 319225391u, 348117739u, 379625083u, 413984099u, 451452839u,
+    492312797u, 536870923u, 585461917u, 638450719u, 696235447u, 759250133u,
+    827968151u, 902905657u, 984625687u, 1073741827u, 1170923777u, 1276901429u,
+    1392470869u, 1518500279u, 1655936281u, 1805811341u, 1969251217u,
+    2147483659u, 2341847531u, 2553802871u, 2784941749u, 3037000507u,
+    3311872549u, 3611622607u, 3938502391u, 4294967291u};
+
+constexpr size_t kPrimeCount = std::size(kPrimes);
+
+// Lemire's fastmod: x % d == MulHi64(x * (2^64 / d + 1), d) for 32-bit x
+// and d, which replaces the division by two multiplies.
+constexpr std::array<uint64_t, kPrimeCount> MakeReciprocals() {
+  std::array<uint64_t, kPrimeCount> reciprocals = {};
+  for (size_t i = 0; i < kPrimeCount; ++i) {
+    reciprocals[i] = UINT64_MAX / kPrimes[i] + 1;
+  }
+  return reciprocals;
+}
+
+constexpr std::array<uint64_t, kPrimeCount> kReciprocals = MakeReciprocals();
+
+}  // namespace growth_internal
+
+// Masks the hash with a power-of-two size and doubles. The cheapest
+// mapping, but it uses only the low bits of the hash.
+class PowerOfTwoGrowth {
+ public:
+  explicit PowerOfTwoGrowth(size_t size) : mask_(size - 1) {}
+
+  static size_t RoundUp(size_t count) {
+    size_t size = 1;
+    while (size < count) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  static size_t Grow(size_t size) {
+    return size << 1;
+  }
+
+  size_t Index(size_t hash) const {
+    return hash & mask_;
+  }
+
+ private:
+  size_t mask_;
+};
+
+// Prime table sizes, grown by GrowthNum/GrowthDen and rounded up to the
+// next prime. Every hash bit affects the bucket, and the modulus uses a
+// precomputed reciprocal instead of a division. Tables are limited to
+// 2^32 buckets.
+template <size_t GrowthNum = 2, size_t GrowthDen = 1>
+class PrimeGrowth {
+ public:
+  explicit PrimeGrowth(size_t size)
+      : prime_(static_cast<uint32_t>(size)),
+        reciprocal_(growth_internal::kReciprocals[Position(size)]) {}
+
+  static size_t RoundUp(size_t count) {
+    return growth_internal::kPrimes[Position(count)];
+  }
+
+  static size_t Grow(size_t size) {
+    return RoundUp(growth_internal::ScaleUp<GrowthNum, GrowthDen>(size));
+  }
+
+  size_t Index(size_t hash) const {
+    uint64_t wide = hash;
+    uint32_t folded = static_cast<uint32_t>(wide ^ (wide >> 32));
+    return growth_internal::MulHi64(reciprocal_ * folded, prime_);
+  }
+
+ private:
+  static size_t Position(size_t count) {
+    const uint32_t *end = std::end(growth_internal::kPrimes);
+    const uint32_t *it =
+        std::lower_bound(std::begin(growth_internal::kPrimes), end, count);
+    if (it == end) {
+      throw std::length_error("hash table too large");
+    }
+    return it - std::begin(growth_internal::kPrimes);
+  }
+
+  uint32_t prime_;
+  uint64_t reciprocal_;
+};
+
+// Any table size, grown by GrowthNum/GrowthDen. The bucket is the high half
+// of hash * size (Lemire's fastrange), so the hash must be well mixed in
+// its high bits; DefaultHash is, an identity hash is not.
+template <size_t GrowthNum = 2, size_t GrowthDen = 1>
+class FastRangeGrowth {
+ public:
+  explicit FastRangeGrowth(size_t size) : size_(size) {}
+
+  static size_t RoundUp(size_t count) {
+    return count > 0 ? count : 1;
+  }
+
+  static size_t Grow(size_t size) {
+    return growth_internal::ScaleUp<GrowthNum, GrowthDen>(size);
+  }
+
+  size_t Index(size_t hash) const {
+    return growth_internal::MulHi64(hash, size_);
+  }
+
+ private:
+  size_t size_;
+};
@@ -0,0 +1,158 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace parallel_internal {
+
+inline size_t DefaultThreads() {
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores != 0 ? cores : 1;
+}
+
+// Threads kept for RunChunks() across calls, started as calls ask for
+// more of them and joined at exit.
+class WorkerPool {
+ public:
+  static WorkerPool &Instance() {
+    static WorkerPool pool;
+    return pool;
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Queues `count` runs of `task`, starting workers until there are as
+  // many, or as many as the system allows.
+  void Post(const std::function<void()> &task, size_t count) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      while (workers_.size() < count) {
+        try {
+          workers_.emplace_back([this] { Work(); });
+        } catch (const std::system_error &) {
+          break;
+        }
+      }
+      tasks_.insert(tasks_.end(), count, task);
+    }
+    ready_.notify_all();
+  }
+
+ private:
+  void Work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  bool stopping_ = false;
+};
+
+// Pool workers joining one RunChunks() call. Once the caller has run out of
+// chunks the call is closed: workers that have not joined by then skip it,
+// so the caller waits only for chunks in progress and never for queued
+// tasks, which keeps nested calls from deadlocking.
+struct ChunkHelpers {
+  std::mutex mutex;
+  std::condition_variable finished;
+  size_t active = 0;
+  bool closed = false;
+};
+
+// Calls fn(chunk) for every chunk in [0, chunks) on up to `threads` threads,
+// the calling one included; 0 means one per core. The other threads come
+// from WorkerPool. Threads take the next chunk as they finish one, so
+// uneven chunks still balance. The first exception thrown by fn stops the
+// remaining chunks and is rethrown here.
+template <class Fn>
+void RunChunks(size_t chunks, size_t threads, Fn fn) {
+  if (threads == 0) {
+    threads = DefaultThreads();
+  }
+  threads = std::min(threads, chunks);
+  if (threads <= 1) {
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      fn(chunk);
+    }
+    return;
+  }
+  std::atomic<size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&] {
+    try {
+      size_t chunk;
+      while ((chunk = next.fetch_add(1, std::memory_order_relaxed)) <
+             chunks) {
+        fn(chunk);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      next.store(chunks, std::memory_order_relaxed);
+    }
+  };
+  auto helpers = std::make_shared<ChunkHelpers>();
+  WorkerPool::Instance().Post(
+      [helpers, &work] {
+        {
+          std::lock_guard<std::mutex> lock(helpers->mutex);
+          if (helpers->closed) {
+            return;
+          }
+          ++helpers->active;
+        }
+        work();
+        std::lock_guard<std::mutex> lock(helpers->mutex);
+        if (--helpers->active == 0) {
+          helpers->finished.notify_all();
+        }
+      },
+      threads - 1);
+  work();
+  {
+    std::unique_lock<std::mutex> lock(helpers->mutex);
+    helpers->closed = true;
+    helpers->finished.wait(lock, [&] { return helpers->active == 0; });
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace parallel_internal
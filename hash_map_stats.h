@@ -0,0 +1,139 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Number of chain nodes walked by lookups; the last bin counts everything
+// from kProbeHistogramSize - 1 up.
+constexpr size_t kProbeHistogramSize = 16;
+
+// Snapshot returned by HashMap::stats().
+struct HashMapStats {
+  uint64_t finds = 0;
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t inserts = 0;
+  uint64_t erases = 0;
+  uint64_t resizes = 0;
+  std::chrono::nanoseconds resize_time{0};
+  std::array<uint64_t, kProbeHistogramSize> probe_histogram = {};
+  size_t max_bucket_length = 0;
+  size_t memory_bytes = 0;
+
+  std::string ToText() const;
+
+  std::string ToJson() const;
+};
+
+inline std::string HashMapStats::ToText() const {
+  std::ostringstream out;
+  out << "finds: " << finds << " (hits: " << hits << ", misses: " << misses
+      << ")\n"
+      << "inserts: " << inserts << "\n"
+      << "erases: " << erases << "\n"
+      << "resizes: " << resizes << " (" << resize_time.count() << " ns)\n"
+      << "max bucket length: " << max_bucket_length << "\n"
+      << "memory: " << memory_bytes << " bytes\n"
+      << "probe lengths:";
+  for (size_t i = 0; i < probe_histogram.size(); ++i) {
+    out << " " << i << (i + 1 == probe_histogram.size() ? "+" : "") << ":"
+        << probe_histogram[i];
+  }
+  out << "\n";
+  return out.str();
+}
+
+inline std::string HashMapStats::ToJson() const {
+  std::ostringstream out;
+  out << "{\"finds\":" << finds << ",\"hits\":" << hits
+      << ",\"misses\":" << misses << ",\"inserts\":" << inserts
+      << ",\"erases\":" << erases << ",\"resizes\":" << resizes
+      << ",\"resize_time_ns\":" << resize_time.count()
+      << ",\"max_bucket_length\":" << max_bucket_length
+      << ",\"memory_bytes\":" << memory_bytes << ",\"probe_histogram\":[";
+  for (size_t i = 0; i < probe_histogram.size(); ++i) {
+    out << (i == 0 ? "" : ",") << probe_histogram[i];
+  }
+  out << "]}";
+  return out.str();
+}
+
+// Bucket occupancy of a HashMap compared with a uniform hash, returned by
+// HashMap::hash_quality(). For a good hash normalized_chi_squared is close
+// to 1 and empty_buckets close to expected_empty_buckets; values well above
+// that mean the hash clusters keys under the map's GrowthPolicy.
+struct HashQualityReport {
+  size_t bucket_count = 0;
+  size_t size = 0;
+  double load_factor = 0;
+  double chi_squared = 0;
+  double normalized_chi_squared = 0;  // chi_squared / (bucket_count - 1)
+  size_t max_bucket_size = 0;
+  size_t empty_buckets = 0;
+  double expected_empty_buckets = 0;
+};
+
+// Bytes a HashMap has requested from its allocator, returned by
+// HashMap::memory_usage(). The allocator adds its own per-block overhead
+// on top; `allocations` is the number of live blocks to account for it.
+struct HashMapMemoryUsage {
+  size_t object_bytes = 0;        // sizeof the map itself
+  size_t bucket_array_bytes = 0;  // chain heads, by capacity
+  size_t element_node_bytes = 0;  // one list node per entry
+  size_t allocations = 0;
+  size_t total_bytes = 0;
+  double bytes_per_entry = 0;  // total_bytes / size(), 0 when empty
+};
+
+// Statistics policies for HashMap's Stats parameter. NoStats is empty and
+// its hooks compile away; CollectStats counts into a HashMapStats.
+struct NoStats {
+  static constexpr bool kEnabled = false;
+
+  void OnFind(size_t, bool) {}
+  void OnInsert() {}
+  void OnErase() {}
+  void OnResize(std::chrono::nanoseconds) {}
+};
+
+class CollectStats {
+ public:
+  static constexpr bool kEnabled = true;
+
+  void OnFind(size_t probes, bool hit) {
+    ++counters_.finds;
+    ++(hit ? counters_.hits : counters_.misses);
+    ++counters_.probe_histogram[probes < kProbeHistogramSize
+                                    ? probes
+                                    : kProbeHistogramSize - 1];
+  }
+
+  void OnInsert() {
+    ++counters_.inserts;
+  }
+
+  void OnErase() {
+    ++counters_.erases;
+  }
+
+  void OnResize(std::chrono::nanoseconds elapsed) {
+    ++counters_.resizes;
+    counters_.resize_time += elapsed;
+  }
+
+  const HashMapStats &counters() const {
+    return counters_;
+  }
+
+  void Reset() {
+    counters_ = HashMapStats();
+  }
+
+ private:
+  HashMapStats counters_;
+};
@@ -0,0 +1,116 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define HASH_MAP_TRACE_USDT 1
+#endif
+#endif
+
+// Listener policies for HashMap. A listener is notified when the bucket
+// table is resized and when a hashed lookup walks more than
+// long_probe_threshold() chain nodes. Bucket counts are 0 for a small map,
+// which has no table. With NoListener the calls compile away.
+struct NoListener {
+  static constexpr bool kEnabled = false;
+
+  size_t long_probe_threshold() const {
+    return 0;
+  }
+
+  void OnResizeStart(size_t, size_t) {}
+  void OnResizeEnd(size_t, size_t) {}
+  void OnLongProbe(size_t, size_t) {}
+};
+
+// Forwards events to user callbacks; unset callbacks are skipped.
+class CallbackListener {
+ public:
+  static constexpr bool kEnabled = true;
+
+  using ResizeCallback = std::function<void(size_t, size_t)>;
+  using ProbeCallback = std::function<void(size_t, size_t)>;
+
+  size_t long_probe_threshold() const {
+    return long_probe_threshold_;
+  }
+
+  void set_long_probe_threshold(size_t probes) {
+    long_probe_threshold_ = probes;
+  }
+
+  // Called with the old and the new bucket count.
+  void set_on_resize_start(ResizeCallback callback) {
+    on_resize_start_ = std::move(callback);
+  }
+
+  void set_on_resize_end(ResizeCallback callback) {
+    on_resize_end_ = std::move(callback);
+  }
+
+  // Called with the number of nodes walked and the bucket index.
+  void set_on_long_probe(ProbeCallback callback) {
+    on_long_probe_ = std::move(callback);
+  }
+
+  void OnResizeStart(size_t old_buckets, size_t new_buckets) {
+    if (on_resize_start_) {
+      on_resize_start_(old_buckets, new_buckets);
+    }
+  }
+
+  void OnResizeEnd(size_t old_buckets, size_t new_buckets) {
+    if (on_resize_end_) {
+      on_resize_end_(old_buckets, new_buckets);
+    }
+  }
+
+  void OnLongProbe(size_t probes, size_t bucket) {
+    if (on_long_probe_) {
+      on_long_probe_(probes, bucket);
+    }
+  }
+
+ private:
+  size_t long_probe_threshold_ = 8;
+  ResizeCallback on_resize_start_;
+  ResizeCallback on_resize_end_;
+  ProbeCallback on_long_probe_;
+};
+
+#ifdef HASH_MAP_TRACE_USDT
+// Fires the USDT probes hash_map:resize_start, hash_map:resize_end and
+// hash_map:long_probe, e.g. for `perf probe sdt_hash_map:resize_start` or
+// bpftrace. Probes cost a nop while nothing is attached.
+class UsdtListener {
+ public:
+  static constexpr bool kEnabled = true;
+
+  explicit UsdtListener(size_t long_probe_threshold = 8)
+      : long_probe_threshold_(long_probe_threshold) {}
+
+  size_t long_probe_threshold() const {
+    return long_probe_threshold_;
+  }
+
+  void OnResizeStart(size_t old_buckets, size_t new_buckets) {
+    DTRACE_PROBE2(hash_map, resize_start, old_buckets, new_buckets);
+  }
+
+  void OnResizeEnd(size_t old_buckets, size_t new_buckets) {
+    DTRACE_PROBE2(hash_map, resize_end, old_buckets, new_buckets);
+  }
+
+  void OnLongProbe(size_t probes, size_t bucket) {
+    DTRACE_PROBE2(hash_map, long_probe, probes, bucket);
+  }
+
+ private:
+  size_t long_probe_threshold_;
+};
+#endif
@@ -0,0 +1,601 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash_functions.h"
+
+// Open-addressing hash table with hopscotch hashing and the interface of
+// HashMap. Every entry is kept within kNeighborhood slots of its home slot,
+// and each home slot has a bitmap of the neighbourhood slots holding its
+// entries, so find() inspects only those slots. An insert that finds a free
+// slot too far away hops entries towards it within their own
+// neighbourhoods. This keeps lookups bounded at load factors of 90% and
+// more (see set_max_load_factor()).
+//
+// Entries that cannot be brought into their neighbourhood go to an overflow
+// area only when growing would leave the table nearly empty, which takes a
+// hash that maps many keys to the same slot.
+//
+// Inserting may move other entries and invalidates iterators; erasing
+// invalidates only iterators to the erased entry. Moving an entry
+// move-constructs the pair, which copies the const key.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class HopscotchHashMap {
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+  static constexpr size_t kNeighborhood = 64;
+
+  using SlotStorage = std::aligned_storage_t<sizeof(ConstKeyValuePair),
+                                             alignof(ConstKeyValuePair)>;
+
+  struct Bucket {
+    Bucket() = default;
+    Bucket(const Bucket &other) = delete;
+    Bucket &operator=(const Bucket &other) = delete;
+
+    ~Bucket() {
+      if (occupied) {
+        std::destroy_at(&value());
+      }
+    }
+
+    ConstKeyValuePair &value() {
+      return *std::launder(reinterpret_cast<ConstKeyValuePair *>(&storage));
+    }
+
+    const ConstKeyValuePair &value() const {
+      return *std::launder(
+          reinterpret_cast<const ConstKeyValuePair *>(&storage));
+    }
+
+    uint64_t hop = 0;  // bit i: slot home + i holds an entry of this home
+    bool occupied = false;
+    uint32_t overflowed = 0;  // entries of this home in the overflow
+    SlotStorage storage;
+  };
+
+  // Walks the occupied slots, the overflow area included, in storage order.
+  template <class BucketPointer, class Value>
+  class SlotIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = ConstKeyValuePair;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value *;
+    using reference = Value &;
+
+    SlotIterator() = default;
+
+    SlotIterator(BucketPointer buckets, size_t pos, size_t end)
+        : buckets_(buckets), pos_(pos), end_(end) {
+      SkipFree();
+    }
+
+    template <class OtherPointer, class OtherValue,
+              class = std::enable_if_t<
+                  std::is_convertible<OtherPointer, BucketPointer>::value>>
+    SlotIterator(const SlotIterator<OtherPointer, OtherValue> &other)
+        : buckets_(other.buckets_), pos_(other.pos_), end_(other.end_) {}
+
+    reference operator*() const {
+      return buckets_[pos_].value();
+    }
+
+    pointer operator->() const {
+      return &buckets_[pos_].value();
+    }
+
+    SlotIterator &operator++() {
+      ++pos_;
+      SkipFree();
+      return *this;
+    }
+
+    SlotIterator operator++(int) {
+      SlotIterator copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    friend bool operator==(const SlotIterator &lhs, const SlotIterator &rhs) {
+      return lhs.pos_ == rhs.pos_;
+    }
+
+    friend bool operator!=(const SlotIterator &lhs, const SlotIterator &rhs) {
+      return lhs.pos_ != rhs.pos_;
+    }
+
+   private:
+    template <class, class>
+    friend class SlotIterator;
+
+    void SkipFree() {
+      while (pos_ < end_ && !buckets_[pos_].occupied) {
+        ++pos_;
+      }
+    }
+
+    BucketPointer buckets_ = nullptr;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+  };
+
+ public:
+  using iterator = SlotIterator<Bucket *, ConstKeyValuePair>;
+  using const_iterator = SlotIterator<const Bucket *, const ConstKeyValuePair>;
+
+  HopscotchHashMap(const Hash &hash = RandomlySeededHash<Hash>(),
+                   const KeyEqual &equal = KeyEqual());
+
+  template <class ContainerIterator>
+  HopscotchHashMap(ContainerIterator begin, ContainerIterator end,
+                   const Hash &hash = RandomlySeededHash<Hash>(),
+                   const KeyEqual &equal = KeyEqual());
+
+  HopscotchHashMap(std::initializer_list<ConstKeyValuePair> initial,
+                   const Hash &hash = RandomlySeededHash<Hash>(),
+                   const KeyEqual &equal = KeyEqual());
+
+  HopscotchHashMap(const HopscotchHashMap &other);
+
+  ~HopscotchHashMap() = default;
+
+  ValueType &operator[](const KeyType &key);
+
+  HopscotchHashMap &operator=(const HopscotchHashMap &other);
+
+  const ValueType &at(const KeyType &key) const;
+
+  void insert(const ConstKeyValuePair &elem);
+
+  void erase(const KeyType &key);
+
+  iterator find(const KeyType &key) {
+    return iterator(buckets_.data(), Locate(key, hasher_(key)),
+                    buckets_.size());
+  }
+
+  const_iterator find(const KeyType &key) const {
+    return const_iterator(buckets_.data(), Locate(key, hasher_(key)),
+                          buckets_.size());
+  }
+
+  bool contains(const KeyType &key) const {
+    return Locate(key, hasher_(key)) != buckets_.size();
+  }
+
+  iterator begin() {
+    return iterator(buckets_.data(), 0, buckets_.size());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(buckets_.data(), 0, buckets_.size());
+  }
+
+  iterator end() {
+    return iterator(buckets_.data(), buckets_.size(), buckets_.size());
+  }
+
+  const_iterator end() const {
+    return const_iterator(buckets_.data(), buckets_.size(), buckets_.size());
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  Hash hash_function() const {
+    return hasher_;
+  }
+
+  KeyEqual key_eq() const {
+    return key_equal_;
+  }
+
+  void clear();
+
+  // Sizes the table so that `count` entries fit without growing.
+  void reserve(size_t count);
+
+  // Home slots; the table has kNeighborhood - 1 more slots after the last
+  // home so that neighbourhoods do not wrap around.
+  size_t bucket_count() const {
+    return table_size_;
+  }
+
+  size_t overflow_size() const {
+    return overflow_count_;
+  }
+
+  double load_factor() const {
+    return static_cast<double>(size_) / table_size_;
+  }
+
+  // The table doubles when an insert would exceed `factor`, which must be in
+  // (0, 1]. Defaults to 0.9.
+  void set_max_load_factor(double factor);
+
+  double max_load_factor() const {
+    return max_load_factor_;
+  }
+
+ private:
+  // A failed insert grows the table only if its load stays above this.
+  static constexpr double kMinLoadFactor = 0.1;
+  const size_t initialSize_ = 8;
+
+  static size_t LowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    size_t i = 0;
+    for (; (bits & 1) == 0; bits >>= 1) {
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  // Slots that can hold entries placed by hopscotch, before the overflow.
+  size_t TableEnd() const {
+    return table_size_ + kNeighborhood - 1;
+  }
+
+  // Slot of the entry with `key`, or buckets_.size().
+  size_t Locate(const KeyType &key, size_t hash) const;
+
+  // Moves an entry into the free slot at *free from an earlier slot, within
+  // the entry's neighbourhood, and points *free at the slot it left.
+  bool HopCloser(size_t *free);
+
+  void Move(size_t from, size_t to);
+
+  // Stores a new entry without growing; false if it fits nowhere.
+  template <class Entry>
+  bool Place(Entry &&elem, size_t hash, size_t *pos);
+
+  // Stores an entry known to be absent, growing as needed.
+  template <class Entry>
+  size_t InsertNew(Entry &&elem, size_t hash);
+
+  // Moves every entry out of the table.
+  std::vector<ConstKeyValuePair> TakeEntries();
+
+  // Grows after an insert found no room.
+  void GrowForPlacement();
+
+  void Resize(size_t table_size, size_t overflow_slots);
+
+  size_t size_ = 0;
+  size_t table_size_ = initialSize_;
+  size_t mask_ = initialSize_ - 1;
+  size_t overflow_count_ = 0;
+  double max_load_factor_ = 0.9;
+  std::vector<Bucket> buckets_ =
+      std::vector<Bucket>(initialSize_ + kNeighborhood - 1);
+  Hash hasher_;
+  KeyEqual key_equal_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::HopscotchHashMap(
+    const Hash &hash, const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class ContainerIterator>
+HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::HopscotchHashMap(
+    ContainerIterator begin, ContainerIterator end, const Hash &hash,
+    const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (auto element = begin; element != end; ++element) {
+    insert(*element);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::HopscotchHashMap(
+    std::initializer_list<ConstKeyValuePair> initial, const Hash &hash,
+    const KeyEqual &equal)
+    : hasher_(hash), key_equal_(equal) {
+  for (const auto &element : initial) {
+    insert(element);
+  }
+}
+
+// Copies slot by slot; the hasher is shared, so every entry keeps its place.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::HopscotchHashMap(
+    const HopscotchHashMap &other)
+    : size_(other.size_),
+      table_size_(other.table_size_),
+      mask_(other.mask_),
+      overflow_count_(other.overflow_count_),
+      max_load_factor_(other.max_load_factor_),
+      buckets_(other.buckets_.size()),
+      hasher_(other.hasher_),
+      key_equal_(other.key_equal_) {
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    const Bucket &from = other.buckets_[i];
+    Bucket &to = buckets_[i];
+    if (from.occupied) {
+      new (&to.storage) ConstKeyValuePair(from.value());
+      to.occupied = true;
+    }
+    to.hop = from.hop;
+    to.overflowed = from.overflowed;
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType &HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::operator[](
+    const KeyType &key) {
+  size_t hash = hasher_(key);
+  size_t pos = Locate(key, hash);
+  if (pos == buckets_.size()) {
+    pos = InsertNew(ConstKeyValuePair(key, ValueType()), hash);
+  }
+  return buckets_[pos].value().second;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::operator=(
+    const HopscotchHashMap &other) -> HopscotchHashMap & {
+  if (this != &other) {
+    HopscotchHashMap copy(other);
+    std::swap(size_, copy.size_);
+    std::swap(table_size_, copy.table_size_);
+    std::swap(mask_, copy.mask_);
+    std::swap(overflow_count_, copy.overflow_count_);
+    std::swap(max_load_factor_, copy.max_load_factor_);
+    buckets_.swap(copy.buckets_);
+    std::swap(hasher_, copy.hasher_);
+    std::swap(key_equal_, copy.key_equal_);
+  }
+  return *this;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+const ValueType &HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::at(
+    const KeyType &key) const {
+  const_iterator it = find(key);
+  if (it != end()) {
+    return it->second;
+  }
+  throw std::out_of_range("Bad request");
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::insert(
+    const ConstKeyValuePair &elem) {
+  size_t hash = hasher_(elem.first);
+  if (Locate(elem.first, hash) == buckets_.size()) {
+    InsertNew(elem, hash);
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::erase(
+    const KeyType &key) {
+  size_t hash = hasher_(key);
+  size_t pos = Locate(key, hash);
+  if (pos == buckets_.size()) {
+    return;
+  }
+  Bucket &bucket = buckets_[pos];
+  std::destroy_at(&bucket.value());
+  bucket.occupied = false;
+  --size_;
+  size_t home = hash & mask_;
+  if (pos < TableEnd()) {
+    buckets_[home].hop &= ~(uint64_t{1} << (pos - home));
+  } else {
+    --buckets_[home].overflowed;
+    --overflow_count_;
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::clear() {
+  size_ = 0;
+  table_size_ = initialSize_;
+  mask_ = initialSize_ - 1;
+  overflow_count_ = 0;
+  buckets_ = std::vector<Bucket>(TableEnd());
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::reserve(
+    size_t count) {
+  size_t new_size = table_size_;
+  while (count > new_size * max_load_factor_) {
+    new_size <<= 1;
+  }
+  if (new_size != table_size_) {
+    Resize(new_size, buckets_.size() - TableEnd());
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::set_max_load_factor(
+    double factor) {
+  if (!(factor > 0 && factor <= 1)) {
+    throw std::invalid_argument("max load factor out of range");
+  }
+  max_load_factor_ = factor;
+  reserve(size_);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+size_t HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::Locate(
+    const KeyType &key, size_t hash) const {
+  size_t home = hash & mask_;
+  const Bucket &bucket = buckets_[home];
+  for (uint64_t bits = bucket.hop; bits != 0; bits &= bits - 1) {
+    size_t pos = home + LowestBit(bits);
+    if (key_equal_(buckets_[pos].value().first, key)) {
+      return pos;
+    }
+  }
+  if (bucket.overflowed != 0) {
+    for (size_t pos = TableEnd(); pos < buckets_.size(); ++pos) {
+      if (buckets_[pos].occupied &&
+          key_equal_(buckets_[pos].value().first, key)) {
+        return pos;
+      }
+    }
+  }
+  return buckets_.size();
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+bool HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::HopCloser(
+    size_t *free) {
+  for (size_t home = *free - (kNeighborhood - 1); home < *free; ++home) {
+    uint64_t bits = buckets_[home].hop;
+    if (bits == 0) {
+      continue;
+    }
+    size_t pos = home + LowestBit(bits);
+    if (pos < *free) {
+      Move(pos, *free);
+      buckets_[home].hop ^= (uint64_t{1} << (pos - home)) |
+                            (uint64_t{1} << (*free - home));
+      *free = pos;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::Move(size_t from,
+                                                                size_t to) {
+  new (&buckets_[to].storage)
+      ConstKeyValuePair(std::move(buckets_[from].value()));
+  buckets_[to].occupied = true;
+  std::destroy_at(&buckets_[from].value());
+  buckets_[from].occupied = false;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Entry>
+bool HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::Place(
+    Entry &&elem, size_t hash, size_t *pos) {
+  size_t home = hash & mask_;
+  size_t free = home;
+  while (free < TableEnd() && buckets_[free].occupied) {
+    ++free;
+  }
+  while (free < TableEnd() && free - home >= kNeighborhood &&
+         HopCloser(&free)) {
+  }
+  if (free < TableEnd() && free - home < kNeighborhood) {
+    buckets_[home].hop |= uint64_t{1} << (free - home);
+  } else {
+    free = TableEnd();
+    while (free < buckets_.size() && buckets_[free].occupied) {
+      ++free;
+    }
+    if (free == buckets_.size()) {
+      return false;
+    }
+    ++buckets_[home].overflowed;
+    ++overflow_count_;
+  }
+  new (&buckets_[free].storage) ConstKeyValuePair(std::forward<Entry>(elem));
+  buckets_[free].occupied = true;
+  *pos = free;
+  return true;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+template <class Entry>
+size_t HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::InsertNew(
+    Entry &&elem, size_t hash) {
+  if (size_ + 1 > table_size_ * max_load_factor_) {
+    Resize(table_size_ * 2, 0);
+  }
+  size_t pos;
+  while (!Place(std::forward<Entry>(elem), hash, &pos)) {
+    GrowForPlacement();
+  }
+  ++size_;
+  return pos;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::TakeEntries()
+    -> std::vector<ConstKeyValuePair> {
+  std::vector<ConstKeyValuePair> entries;
+  entries.reserve(size_);
+  for (Bucket &bucket : buckets_) {
+    if (bucket.occupied) {
+      entries.push_back(std::move(bucket.value()));
+      std::destroy_at(&bucket.value());
+      bucket.occupied = false;
+    }
+  }
+  overflow_count_ = 0;
+  return entries;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::GrowForPlacement() {
+  size_t overflow_slots = buckets_.size() - TableEnd();
+  if (size_ + 1 >= table_size_ * 2 * kMinLoadFactor) {
+    Resize(table_size_ * 2, overflow_slots);
+  } else {
+    Resize(table_size_, std::max(overflow_slots * 2, kNeighborhood));
+  }
+}
+
+// Grows again, by the same rule as GrowForPlacement(), whenever the entries
+// do not all fit. The overflow eventually holds everything, so this ends.
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void HopscotchHashMap<KeyType, ValueType, Hash, KeyEqual>::Resize(
+    size_t table_size, size_t overflow_slots) {
+  std::vector<ConstKeyValuePair> entries = TakeEntries();
+  while (true) {
+    table_size_ = table_size;
+    mask_ = table_size - 1;
+    buckets_ = std::vector<Bucket>(TableEnd() + overflow_slots);
+    size_t placed = 0;
+    size_t pos;
+    while (placed < entries.size() &&
+           Place(std::move(entries[placed]), hasher_(entries[placed].first),
+                 &pos)) {
+      ++placed;
+    }
+    if (placed == entries.size()) {
+      return;
+    }
+    std::vector<ConstKeyValuePair> rest = TakeEntries();
+    for (size_t i = placed; i < entries.size(); ++i) {
+      rest.push_back(std::move(entries[i]));
+    }
+    entries.swap(rest);
+    if (entries.size() >= table_size * 2 * kMinLoadFactor) {
+      table_size <<= 1;
+    } else {
+      overflow_slots = std::max(overflow_slots * 2, kNeighborhood);
+    }
+  }
+}
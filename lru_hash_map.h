@@ -0,0 +1,152 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "hash_map.h"
+
+// Bounded cache on top of HashMap. The map's element list doubles as the
+// recency list: the front is the most recently used entry, so a hit is one
+// splice and an entry is a single allocation.
+template <class KeyType, class ValueType, class Hash = DefaultHash<KeyType>,
+          class KeyEqual = std::equal_to<KeyType>>
+class LruHashMap {
+  using Map = HashMap<KeyType, ValueType, Hash, KeyEqual>;
+  using ConstKeyValuePair = std::pair<const KeyType, ValueType>;
+
+ public:
+  using iterator = typename Map::iterator;
+  using const_iterator = typename Map::const_iterator;
+  using EvictionCallback = std::function<void(const KeyType &, ValueType &)>;
+
+  explicit LruHashMap(size_t capacity,
+                      EvictionCallback on_evict = EvictionCallback(),
+                      const Hash &hash = RandomlySeededHash<Hash>(),
+                      const KeyEqual &equal = KeyEqual());
+
+  // Marks the entry as most recently used.
+  iterator find(const KeyType &key);
+
+  // Returns nullptr on a miss; a hit is marked as most recently used.
+  ValueType *get(const KeyType &key);
+
+  // Lookup without touching recency.
+  const_iterator peek(const KeyType &key) const {
+    return map_.find(key);
+  }
+
+  // An existing key is only marked as used; otherwise the least recently
+  // used entry is evicted first if the cache is full.
+  void insert(const ConstKeyValuePair &elem);
+
+  ValueType &operator[](const KeyType &key);
+
+  void erase(const KeyType &key) {
+    map_.erase(key);
+  }
+
+  // Most recently used first.
+  iterator begin() {
+    return map_.begin();
+  }
+
+  const_iterator begin() const {
+    return map_.begin();
+  }
+
+  iterator end() {
+    return map_.end();
+  }
+
+  const_iterator end() const {
+    return map_.end();
+  }
+
+  bool empty() const {
+    return map_.empty();
+  }
+
+  size_t size() const {
+    return map_.size();
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  void clear() {
+    map_.clear();
+  }
+
+ private:
+  void EvictIfFull();
+
+  Map map_;
+  size_t capacity_;
+  EvictionCallback on_evict_;
+};
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+LruHashMap<KeyType, ValueType, Hash, KeyEqual>::LruHashMap(
+    size_t capacity, EvictionCallback on_evict, const Hash &hash,
+    const KeyEqual &equal)
+    : map_(hash, equal), capacity_(capacity), on_evict_(std::move(on_evict)) {
+  if (capacity_ == 0) {
+    throw std::invalid_argument("LruHashMap capacity must be positive");
+  }
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+auto LruHashMap<KeyType, ValueType, Hash, KeyEqual>::find(const KeyType &key)
+-> iterator {
+  iterator it = map_.find(key);
+  if (it != map_.end()) {
+    map_.move_to_front(it);
+  }
+  return it;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType *LruHashMap<KeyType, ValueType, Hash, KeyEqual>::get(
+    const KeyType &key) {
+  iterator it = find(key);
+  return it != map_.end() ? &it->second : nullptr;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void LruHashMap<KeyType, ValueType, Hash, KeyEqual>::insert(
+    const ConstKeyValuePair &elem) {
+  if (find(elem.first) != map_.end()) {
+    return;
+  }
+  EvictIfFull();
+  map_.insert(elem);
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+ValueType &LruHashMap<KeyType, ValueType, Hash, KeyEqual>::operator[](
+    const KeyType &key) {
+  iterator it = find(key);
+  if (it != map_.end()) {
+    return it->second;
+  }
+  EvictIfFull();
+  map_.insert({key, ValueType{}});
+  return map_.begin()->second;
+}
+
+template <class KeyType, class ValueType, class Hash, class KeyEqual>
+void LruHashMap<KeyType, ValueType, Hash, KeyEqual>::EvictIfFull() {
+  if (map_.size() < capacity_) {
+    return;
+  }
+  iterator victim = std::prev(map_.end());
+  if (on_evict_) {
+    on_evict_(victim->first, victim->second);
+  }
+  map_.erase(victim);
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+size_t allocations = 0;
+
+}  // namespace
+
+void *operator new(size_t size) {
+  ++allocations;
+  void *ptr = std::malloc(size != 0 ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+// Past the SSO capacity, so a needless key copy would allocate.
+std::string LongKey(int i) {
+  return "a key long enough for the heap #" + std::to_string(i);
+}
+
+std::string ShortKey(int i) {
+  return std::to_string(i);
+}
+
+void TestLookupsDoNotAllocate(int count) {
+  HashMap<std::string, int> map;
+  std::vector<std::string> keys;
+  for (int i = 0; i < count; ++i) {
+    keys.push_back(LongKey(i));
+    map.insert({keys.back(), i});
+  }
+  size_t before = allocations;
+  long long sum = 0;
+  for (const std::string &key : keys) {
+    sum += map.find(key)->second;
+    sum += map.at(key);
+    sum += map.contains(key);
+    sum += map[key];
+  }
+  CHECK(allocations == before);
+  CHECK(sum == 3LL * count * (count - 1) / 2 + count);
+}
+
+// One list node per entry; table growth adds O(log n) allocations.
+void TestInsertAllocatesOnce(int count) {
+  HashMap<std::string, int> map;
+  std::vector<std::string> keys;
+  for (int i = 0; i < count; ++i) {
+    keys.push_back(ShortKey(i));
+  }
+  size_t before = allocations;
+  for (const std::string &key : keys) {
+    map.insert({key, 0});
+  }
+  CHECK(allocations - before <= keys.size() + 64);
+
+  // A long key is copied into the node: one more allocation for it.
+  HashMap<std::string, int> long_map;
+  keys.clear();
+  for (int i = 0; i < count; ++i) {
+    keys.push_back(LongKey(i));
+  }
+  before = allocations;
+  for (const std::string &key : keys) {
+    long_map[key] = 0;
+  }
+  CHECK(allocations - before <= 2 * keys.size() + 64);
+}
+
+}  // namespace
+
+int main() {
+  for (int count : {5, 100000}) {
+    TestLookupsDoNotAllocate(count);
+    TestInsertAllocatesOnce(count);
+  }
+  return 0;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <stdexcept>
+
+#include "check.h"
+#include "colliding_hash.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 2000;
+
+// Negative keys collide under every seed, so the chain stays over the limit
+// after the reseed; without a resize in between it must not reseed again.
+void TestAdversarialChainReseedsOnce() {
+  int reseeds = 0;
+  HashMap<int, int, CollidingHash> map{CollidingHash(&reseeds)};
+  map.set_max_chain_length(8);
+  map.reserve(4 * kKeys);
+  size_t buckets = map.bucket_count();
+  for (int key = 1; key <= kKeys; ++key) {
+    map.insert({-key, key});
+  }
+  CHECK(map.bucket_count() == buckets);
+  CHECK(reseeds == 1);
+  CHECK(map.size() == kKeys);
+  for (int key = 1; key <= kKeys; ++key) {
+    CHECK(map.at(-key) == key);
+  }
+  CHECK(map.find(0) == map.end());
+}
+
+// Random hashing stays under the limit, so past the reseed out of the
+// initial seed's collisions another one is rare.
+void TestSpreadKeysDoNotReseed() {
+  int reseeds = 0;
+  HashMap<int, int, CollidingHash> map{CollidingHash(&reseeds)};
+  map.set_max_chain_length(8);
+  for (int key = 0; key < 100 * kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(reseeds >= 1 && reseeds <= 2);
+  for (int key = 0; key < 100 * kKeys; ++key) {
+    CHECK(map.at(key) == key);
+  }
+}
+
+void TestSmallLimitRejected() {
+  HashMap<int, int> map;
+  bool thrown = false;
+  try {
+    map.set_max_chain_length(3);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  CHECK(map.max_chain_length() == 0);
+  map.set_max_chain_length(8);
+  map.set_max_chain_length(0);
+  CHECK(map.max_chain_length() == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestAdversarialChainReseedsOnce();
+  TestSpreadKeysDoNotReseed();
+  TestSmallLimitRejected();
+  return 0;
+}
@@ -0,0 +1,16 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// The tests are plain executables: a failed CHECK prints its location and
+// exits non-zero, which is what ctest looks at.
+#define CHECK(condition)                                                \
+  do {                                                                  \
+    if (!(condition)) {                                                 \
+      std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__,       \
+                   __LINE__, #condition);                               \
+      std::exit(1);                                                     \
+    }                                                                   \
+  } while (false)
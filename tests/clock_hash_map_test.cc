@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "clock_hash_map.h"
+
+namespace {
+
+constexpr size_t kCapacity = 8;
+
+// Textbook CLOCK over a circular array of frames: the victim's frame takes
+// the new entry and the hand moves on past it.
+class ClockModel {
+ public:
+  struct Frame {
+    int key;
+    bool referenced;
+  };
+
+  // Returns the evicted key, or -1.
+  int Access(int key) {
+    for (Frame &frame : frames_) {
+      if (frame.key == key) {
+        frame.referenced = true;
+        return -1;
+      }
+    }
+    if (frames_.size() < kCapacity) {
+      frames_.push_back({key, false});
+      return -1;
+    }
+    while (frames_[hand_].referenced) {
+      frames_[hand_].referenced = false;
+      hand_ = (hand_ + 1) % kCapacity;
+    }
+    int victim = frames_[hand_].key;
+    frames_[hand_] = {key, false};
+    hand_ = (hand_ + 1) % kCapacity;
+    return victim;
+  }
+
+  const std::vector<Frame> &frames() const {
+    return frames_;
+  }
+
+ private:
+  std::vector<Frame> frames_;
+  size_t hand_ = 0;
+};
+
+// A fresh entry goes behind the hand, so it is evicted only after the hand
+// has passed every other entry, exactly as in the array model.
+void TestMatchesModel() {
+  std::vector<int> evicted;
+  ClockHashMap<int, int> cache(kCapacity, [&evicted](const int &key, int &) {
+    evicted.push_back(key);
+  });
+  ClockModel model;
+  std::vector<int> expected;
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> keys(0, 3 * kCapacity);
+  for (int step = 0; step < 20000; ++step) {
+    int key = keys(random);
+    if (step % 3 == 0) {
+      cache.insert({key, key});
+    } else if (cache.get(key) == nullptr) {
+      cache[key] = key;
+    }
+    int victim = model.Access(key);
+    if (victim >= 0) {
+      expected.push_back(victim);
+    }
+    CHECK(evicted == expected);
+  }
+  CHECK(cache.size() == kCapacity);
+  for (const ClockModel::Frame &frame : model.frames()) {
+    const int *value = cache.peek(frame.key);
+    CHECK(value != nullptr && *value == frame.key);
+  }
+}
+
+void TestEraseAtHand() {
+  ClockHashMap<int, int> cache(2);
+  cache.insert({1, 1});
+  cache.insert({2, 2});
+  cache.insert({3, 3});
+  CHECK(!cache.contains(1));
+  cache.erase(2);
+  cache.erase(3);
+  CHECK(cache.empty());
+  cache.insert({4, 4});
+  cache.insert({5, 5});
+  cache.insert({6, 6});
+  CHECK(cache.size() == 2);
+  CHECK(!cache.contains(4));
+  CHECK(*cache.get(5) == 5 && *cache.get(6) == 6);
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesModel();
+  TestEraseAtHand();
+  return 0;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hash_functions.h"
+
+// A seedable hash for exercising the chain length limit. Under seed 0, the
+// seed it is constructed with, keys fall into four chains; negative keys
+// share one hash whatever the seed. Reseeds are counted into `reseeds`.
+class CollidingHash {
+ public:
+  explicit CollidingHash(int *reseeds = nullptr) : reseeds_(reseeds) {}
+
+  size_t operator()(int key) const {
+    if (key < 0) {
+      return 0;
+    }
+    if (seed_ == 0) {
+      return static_cast<size_t>(key % 4);
+    }
+    return static_cast<size_t>(MixBits(static_cast<uint64_t>(key) ^ seed_));
+  }
+
+  void reseed(uint64_t seed) {
+    seed_ = seed;
+    if (reseeds_ != nullptr) {
+      ++*reseeds_;
+    }
+  }
+
+ private:
+  uint64_t seed_ = 0;
+  int *reseeds_;
+};
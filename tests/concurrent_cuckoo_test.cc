@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "concurrent_cuckoo_hash_map.h"
+
+namespace {
+
+constexpr int kWriters = 4;
+constexpr int kReaders = 2;
+constexpr int kKeys = 5000;  // per writer
+constexpr int kCounter = -1;
+
+// Written as a whole by every writer, so a reader seeing check != ~value
+// copied it while it was being written.
+struct Entry {
+  uint64_t value;
+  uint64_t check;
+};
+
+Entry Make(uint64_t value) {
+  return {value, ~value};
+}
+
+bool Intact(const Entry &entry) {
+  return entry.check == ~entry.value;
+}
+
+using Map = ConcurrentCuckooHashMap<int, Entry>;
+
+auto Increment = [](Entry &entry) { entry = Make(entry.value + 1); };
+
+// Each writer inserts its own keys into a map that starts at two buckets,
+// so the inserts race with growth, then increments them, erases the odd
+// ones and bumps a counter shared by all writers.
+void Write(Map *map, int writer) {
+  int begin = writer * kKeys;
+  for (int key = begin; key < begin + kKeys; ++key) {
+    CHECK(map->insert({key, Make(key)}));
+    map->upsert(kCounter, Increment, Make(1));
+  }
+  for (int key = begin; key < begin + kKeys; ++key) {
+    CHECK(!map->upsert(key, Increment, Make(0)));
+  }
+  for (int key = begin + 1; key < begin + kKeys; key += 2) {
+    CHECK(map->erase(key));
+  }
+}
+
+void Read(const Map &map, const std::atomic<bool> &done, int reader) {
+  std::mt19937 random(reader);
+  std::uniform_int_distribution<int> keys(kCounter, kWriters * kKeys - 1);
+  while (!done.load(std::memory_order_acquire)) {
+    int key = keys(random);
+    Entry entry;
+    if (map.find(key, &entry)) {
+      CHECK(Intact(entry));
+      if (key != kCounter) {
+        CHECK(entry.value == static_cast<uint64_t>(key) ||
+              entry.value == static_cast<uint64_t>(key) + 1);
+      }
+    }
+  }
+}
+
+void TestConcurrentWriters() {
+  Map map;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int reader = 0; reader < kReaders; ++reader) {
+    readers.emplace_back(Read, std::cref(map), std::cref(done), reader);
+  }
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < kWriters; ++writer) {
+    writers.emplace_back(Write, &map, writer);
+  }
+  for (std::thread &writer : writers) {
+    writer.join();
+  }
+  done.store(true, std::memory_order_release);
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+
+  CHECK(map.size() == kWriters * kKeys / 2 + 1);
+  CHECK(map.at(kCounter).value == kWriters * kKeys);
+  for (int key = 0; key < kWriters * kKeys; ++key) {
+    Entry entry;
+    bool found = map.find(key, &entry);
+    CHECK(found == (key % 2 == 0));
+    if (found) {
+      CHECK(Intact(entry));
+      CHECK(entry.value == static_cast<uint64_t>(key) + 1);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestConcurrentWriters();
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <string>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 1000;
+
+using Map = HashMap<int, std::string>;
+
+Map MakeMap(int count) {
+  Map map;
+  for (int key = 0; key < count; ++key) {
+    map.insert({key, std::to_string(key)});
+  }
+  return map;
+}
+
+// The copy shares the hasher's seed, so every key lands in the same bucket
+// and iteration visits the entries in the same order.
+void CheckSameLayout(const Map &copy, const Map &original) {
+  CHECK(copy.size() == original.size());
+  CHECK(copy.bucket_count() == original.bucket_count());
+  CHECK(copy.min_load_factor() == original.min_load_factor());
+  CHECK(copy.max_chain_length() == original.max_chain_length());
+  auto it = original.begin();
+  for (const auto &entry : copy) {
+    CHECK(entry == *it);
+    CHECK(copy.hash_function()(entry.first) ==
+          original.hash_function()(entry.first));
+    CHECK(copy.bucket(entry.first) == original.bucket(entry.first));
+    ++it;
+  }
+  CHECK(it == original.end());
+}
+
+void TestCopyConstructor() {
+  for (int count : {0, 5, kKeys}) {
+    Map original = MakeMap(count);
+    original.set_min_load_factor(0.125);
+    original.set_max_chain_length(16);
+    Map copy(original);
+    CheckSameLayout(copy, original);
+
+    copy[0] = "changed";
+    copy.insert({-1, "-1"});
+    CHECK(!original.contains(-1));
+    CHECK(count == 0 || original.at(0) == "0");
+    original.erase(1);
+    CHECK(count < 2 || copy.at(1) == "1");
+  }
+}
+
+// The target's own table size, seed and settings are all replaced.
+void TestCopyAssignment() {
+  Map original = MakeMap(kKeys);
+  original.set_min_load_factor(0.125);
+  original.reserve(4 * kKeys);
+  for (int count : {0, 5, 10 * kKeys}) {
+    Map copy = MakeMap(count);
+    copy.set_max_chain_length(32);
+    copy = original;
+    CheckSameLayout(copy, original);
+    copy.erase(2);
+    CHECK(original.at(2) == "2");
+  }
+
+  Map small = MakeMap(5);
+  Map copy = MakeMap(kKeys);
+  copy = small;
+  CheckSameLayout(copy, small);
+  CHECK(copy.memory_usage().bucket_array_bytes == 0);
+  copy.insert({-1, "-1"});
+  CHECK(!small.contains(-1));
+}
+
+void TestSelfAssignment() {
+  Map map = MakeMap(kKeys);
+  size_t buckets = map.bucket_count();
+  const Map &same = map;
+  map = same;
+  CHECK(map.size() == kKeys);
+  CHECK(map.bucket_count() == buckets);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.at(key) == std::to_string(key));
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestCopyConstructor();
+  TestCopyAssignment();
+  TestSelfAssignment();
+  return 0;
+}
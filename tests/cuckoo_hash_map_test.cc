@@ -0,0 +1,64 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstdint>
+#include <string>
+
+#include "check.h"
+#include "cuckoo_hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 20000;
+
+// Four 16-byte pairs and their tags take 72 bytes, so a uint64_t bucket
+// drops to three slots to stay within one cache line.
+static_assert(CuckooHashMap<int, int>::slots_per_bucket() == 4, "");
+static_assert(CuckooHashMap<uint64_t, uint64_t>::slots_per_bucket() == 3,
+              "");
+using StringMap = CuckooHashMap<std::string, std::string>;
+static_assert(StringMap::slots_per_bucket() == 2, "");
+
+template <class Map, class MakeKey>
+void CheckInsertFindErase(MakeKey make_key) {
+  Map map;
+  for (int i = 0; i < kKeys; ++i) {
+    map.insert({make_key(i), make_key(i)});
+  }
+  CHECK(map.size() == kKeys);
+  CHECK(map.load_factor() <= 0.9);
+  for (int i = 0; i < kKeys; i += 2) {
+    map.erase(make_key(i));
+  }
+  CHECK(map.size() == kKeys / 2);
+  for (int i = 0; i < kKeys; ++i) {
+    auto it = map.find(make_key(i));
+    if (i % 2 == 0) {
+      CHECK(it == map.end());
+    } else {
+      CHECK(it != map.end() && it->second == make_key(i));
+    }
+  }
+  size_t count = 0;
+  for (const auto &entry : map) {
+    CHECK(entry.first == entry.second);
+    ++count;
+  }
+  CHECK(count == kKeys / 2);
+}
+
+void TestUint64() {
+  CheckInsertFindErase<CuckooHashMap<uint64_t, uint64_t>>(
+      [](int i) { return static_cast<uint64_t>(i) << 32; });
+}
+
+void TestString() {
+  CheckInsertFindErase<StringMap>(
+      [](int i) { return "key" + std::to_string(i); });
+}
+
+}  // namespace
+
+int main() {
+  TestUint64();
+  TestString();
+  return 0;
+}
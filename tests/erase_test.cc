@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 1000;
+
+using Map = HashMap<int, int>;
+
+Map MakeMap(int count) {
+  Map map;
+  for (int key = 0; key < count; ++key) {
+    map.insert({key, key});
+  }
+  return map;
+}
+
+std::vector<int> Keys(const Map &map) {
+  std::vector<int> keys;
+  for (const auto &entry : map) {
+    keys.push_back(entry.first);
+  }
+  return keys;
+}
+
+// Every key must still be reachable through its chain after the erases.
+void CheckLookups(const Map &map, int count) {
+  size_t found = 0;
+  for (int key = 0; key < count; ++key) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+      CHECK(it->second == key);
+      ++found;
+    }
+  }
+  CHECK(found == map.size());
+  CHECK(static_cast<size_t>(std::distance(map.begin(), map.end())) ==
+        map.size());
+}
+
+// erase(iterator) hands back the entry that followed the erased one.
+void TestEraseIterator() {
+  for (int count : {5, kKeys}) {
+    Map map = MakeMap(count);
+    std::vector<int> keys = Keys(map);
+    size_t index = 0;
+    for (auto it = map.begin(); it != map.end(); ++index) {
+      CHECK(it->first == keys[index]);
+      if (index % 2 == 0) {
+        it = map.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    CHECK(map.size() == keys.size() / 2);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      CHECK(map.contains(keys[i]) == (i % 2 == 1));
+    }
+    CheckLookups(map, count);
+  }
+}
+
+void TestEraseRange() {
+  Map map = MakeMap(kKeys);
+  std::vector<int> keys = Keys(map);
+  auto first = std::next(map.begin(), 100);
+  auto last = std::next(first, 500);
+  auto next = map.erase(first, last);
+  CHECK(next->first == keys[600]);
+  CHECK(map.size() == kKeys - 500);
+  CHECK(map.erase(map.begin(), map.begin()) == map.begin());
+  CheckLookups(map, kKeys);
+
+  CHECK(map.erase(map.begin(), map.end()) == map.end());
+  CHECK(map.empty());
+  map.insert({1, 1});
+  CHECK(map.at(1) == 1);
+}
+
+void TestEraseIf() {
+  for (int count : {5, kKeys}) {
+    Map map = MakeMap(count);
+    size_t erased =
+        map.erase_if([](const auto &entry) { return entry.first % 3 == 0; });
+    CHECK(erased == static_cast<size_t>((count + 2) / 3));
+    CHECK(map.size() == count - erased);
+    for (int key = 0; key < count; ++key) {
+      CHECK(map.contains(key) == (key % 3 != 0));
+    }
+    CheckLookups(map, count);
+
+    erased = erase_if(map, [](const auto &entry) { return entry.second < 4; });
+    CHECK(erased == 2);
+    CHECK(!map.contains(1) && !map.contains(2) && map.contains(4));
+    CHECK(erase_if(map, [](const auto &) { return false; }) == 0);
+    CheckLookups(map, count);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestEraseIterator();
+  TestEraseRange();
+  TestEraseIf();
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "expiring_hash_map.h"
+
+namespace {
+
+// A clock the tests move by hand, so that deadlines are exact.
+struct FakeClock {
+  using duration = std::chrono::milliseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<FakeClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() {
+    return current;
+  }
+
+  static void Advance(int64_t ms) {
+    current += duration(ms);
+  }
+
+  static inline time_point current;
+};
+
+using Map = ExpiringHashMap<int, int, DefaultHash<int>, std::equal_to<int>,
+                            FakeClock>;
+using Ms = std::chrono::milliseconds;
+
+constexpr size_t kAll = std::numeric_limits<size_t>::max();
+
+void TestExpiresAtDeadline() {
+  Map map;
+  map.insert({1, 10}, Ms(10));
+  FakeClock::Advance(9);
+  CHECK(map.find(1) != nullptr && *map.find(1) == 10);
+  map.insert({1, 20}, Ms(100));
+  CHECK(*map.find(1) == 10);
+  FakeClock::Advance(1);
+  CHECK(map.find(1) == nullptr);
+  CHECK(map.empty());
+  map.insert({1, 20}, Ms(100));
+  CHECK(*map.find(1) == 20);
+}
+
+// Deadlines up to 300 s span all four levels of 1 ms ticks; every sweep
+// must reclaim exactly the entries whose tick is over.
+void TestCascade() {
+  Map map;
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int64_t> ttls(1, 300000);
+  std::vector<int64_t> ttl(5000);
+  for (size_t key = 0; key < ttl.size(); ++key) {
+    ttl[key] = ttls(random);
+    map.insert({static_cast<int>(key), static_cast<int>(key)}, Ms(ttl[key]));
+  }
+  std::uniform_int_distribution<int64_t> steps(1, 5000);
+  for (int64_t now = 0; now <= 300001;) {
+    int64_t step = steps(random);
+    FakeClock::Advance(step);
+    now += step;
+    map.sweep(kAll);
+    size_t left = 0;
+    for (int64_t deadline : ttl) {
+      left += deadline >= now;
+    }
+    CHECK(map.size() == left);
+  }
+  CHECK(map.empty());
+}
+
+void TestExpireAfter() {
+  Map map;
+  map.insert({1, 10}, Ms(10));
+  FakeClock::Advance(5);
+  CHECK(map.expire_after(1, Ms(20)));
+  FakeClock::Advance(19);
+  CHECK(map.contains(1));
+  CHECK(map.sweep(kAll) == 0);
+  FakeClock::Advance(2);
+  CHECK(map.sweep(kAll) == 1);
+  CHECK(map.empty());
+  CHECK(!map.expire_after(1, Ms(20)));
+
+  map.insert({2, 20}, Ms(10));
+  FakeClock::Advance(10);
+  CHECK(!map.expire_after(2, Ms(20)));
+  CHECK(map.empty());
+}
+
+void TestSweepBudget() {
+  Map map;
+  for (int key = 0; key < 100; ++key) {
+    map.insert({key, key}, Ms(5));
+  }
+  map.insert({100, 100}, Ms(1000));
+  FakeClock::Advance(10);
+  CHECK(map.sweep(30) == 30);
+  CHECK(map.size() == 71);
+  CHECK(map.sweep(30) == 30);
+  CHECK(map.sweep(kAll) == 40);
+  CHECK(map.sweep(kAll) == 0);
+  CHECK(map.size() == 1);
+  CHECK(map.contains(100));
+}
+
+}  // namespace
+
+int main() {
+  TestExpiresAtDeadline();
+  TestCascade();
+  TestExpireAfter();
+  TestSweepBudget();
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "hash_map.h"
+#include "hash_map_growth.h"
+
+namespace {
+
+constexpr int kKeys = 10000;
+
+bool IsPrime(size_t n) {
+  if (n < 2) {
+    return false;
+  }
+  for (size_t d = 2; d * d <= n; ++d) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<uint64_t> SampleHashes(uint64_t size) {
+  std::vector<uint64_t> hashes = {0, 1, size - 1, size, size + 1, 2 * size,
+                                  UINT32_MAX, UINT64_MAX,
+                                  uint64_t{UINT32_MAX} << 32};
+  std::mt19937_64 random(size);
+  for (int i = 0; i < 200; ++i) {
+    hashes.push_back(random());
+    hashes.push_back(random() % (8 * size));
+  }
+  return hashes;
+}
+
+void TestPowerOfTwo() {
+  CHECK(PowerOfTwoGrowth::RoundUp(2) == 2);
+  CHECK(PowerOfTwoGrowth::RoundUp(3) == 4);
+  CHECK(PowerOfTwoGrowth::RoundUp(1025) == 2048);
+  CHECK(PowerOfTwoGrowth::Grow(64) == 128);
+  PowerOfTwoGrowth policy(64);
+  for (uint64_t hash : SampleHashes(64)) {
+    CHECK(policy.Index(hash) == (hash & 63));
+  }
+}
+
+// fastmod must agree with a real modulus of the folded hash for every size
+// in the table.
+void TestPrimeFastmod() {
+  for (uint32_t prime : growth_internal::kPrimes) {
+    PrimeGrowth<> policy(prime);
+    for (uint64_t hash : SampleHashes(prime)) {
+      uint32_t folded = static_cast<uint32_t>(hash ^ (hash >> 32));
+      CHECK(policy.Index(hash) == folded % prime);
+    }
+  }
+}
+
+void TestPrimeSizes() {
+  CHECK(PrimeGrowth<>::RoundUp(2) == 2);
+  CHECK(PrimeGrowth<>::RoundUp(1000) == 1031);
+  size_t size = 2;
+  for (int step = 0; step < 20; ++step) {
+    size_t next = PrimeGrowth<>::Grow(size);
+    CHECK(IsPrime(next));
+    CHECK(next >= 2 * size);
+    size_t slow = PrimeGrowth<3, 2>::Grow(size);
+    CHECK(IsPrime(slow) && slow > size && slow <= next);
+    size = next;
+  }
+  bool thrown = false;
+  try {
+    PrimeGrowth<>::RoundUp(size_t{UINT32_MAX} + 1);
+  } catch (const std::length_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+void TestFastRange() {
+  using SlowGrowth = FastRangeGrowth<3, 2>;
+  CHECK(FastRangeGrowth<>::RoundUp(1000) == 1000);
+  CHECK(FastRangeGrowth<>::Grow(1000) == 2000);
+  CHECK(SlowGrowth::Grow(2) == 3);
+  CHECK(SlowGrowth::Grow(3) == 4);
+  for (uint64_t size : {1u, 2u, 3u, 1000u, 1031u}) {
+    FastRangeGrowth<> policy(size);
+    for (uint64_t hash : SampleHashes(size)) {
+      CHECK(policy.Index(hash) < size);
+    }
+    CHECK(policy.Index(UINT64_MAX) == size - 1);
+    CHECK(policy.Index(0) == 0);
+  }
+}
+
+template <class GrowthPolicy>
+using Map = HashMap<int, int, DefaultHash<int>, std::equal_to<int>, 8, NoStats,
+                    NoListener, GrowthPolicy>;
+
+// Every table the map builds is a size the policy would choose, and each
+// key is found in the bucket the policy maps it to.
+template <class GrowthPolicy>
+void TestMap(bool (*valid_size)(size_t)) {
+  Map<GrowthPolicy> map;
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, -key});
+    if (key % 997 == 0) {
+      CHECK(valid_size(map.bucket_count()));
+      CHECK(map.load_factor() <= 0.5);
+    }
+  }
+  size_t entries = 0;
+  for (size_t n = 0; n < map.bucket_count(); ++n) {
+    entries += map.bucket_size(n);
+  }
+  CHECK(entries == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.bucket(key) < map.bucket_count());
+    CHECK(map.at(key) == -key);
+  }
+  for (int key = 0; key < kKeys; key += 2) {
+    map.erase(key);
+  }
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.contains(key) == (key % 2 == 1));
+  }
+
+  map.rehash(3 * kKeys);
+  CHECK(map.bucket_count() == GrowthPolicy::RoundUp(3 * kKeys));
+  map.set_min_load_factor(0.125);
+  map.erase_if([](const auto &entry) { return entry.first > 100; });
+  CHECK(valid_size(map.bucket_count()));
+  CHECK(map.load_factor() >= 0.125);
+  map.shrink_to_fit();
+  CHECK(valid_size(map.bucket_count()));
+  CHECK(map.size() == 50);
+  for (int key = 1; key < 100; key += 2) {
+    CHECK(map.at(key) == -key);
+  }
+}
+
+bool IsPowerOfTwo(size_t n) {
+  return n != 0 && (n & (n - 1)) == 0;
+}
+
+bool IsTablePrime(size_t n) {
+  return std::find(std::begin(growth_internal::kPrimes),
+                   std::end(growth_internal::kPrimes),
+                   n) != std::end(growth_internal::kPrimes);
+}
+
+bool IsAnySize(size_t n) {
+  return n != 0;
+}
+
+}  // namespace
+
+int main() {
+  TestPowerOfTwo();
+  TestPrimeFastmod();
+  TestPrimeSizes();
+  TestFastRange();
+  TestMap<PowerOfTwoGrowth>(IsPowerOfTwo);
+  TestMap<PrimeGrowth<>>(IsTablePrime);
+  TestMap<PrimeGrowth<3, 2>>(IsTablePrime);
+  TestMap<FastRangeGrowth<>>(IsAnySize);
+  TestMap<FastRangeGrowth<3, 2>>(IsAnySize);
+  return 0;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "hash_aggregator.h"
+
+namespace {
+
+constexpr size_t kRows = 100000;
+constexpr uint64_t kGroups = 1000;
+
+// SumAggregate that counts Init calls: one per group, never per row.
+struct CountingSum : SumAggregate<int64_t> {
+  State Init(const int64_t &value) const {
+    ++*init_calls;
+    return value;
+  }
+
+  size_t *init_calls;
+};
+
+void TestSumsAndInitCalls(size_t partition_bits) {
+  std::vector<uint64_t> keys(kRows);
+  std::vector<int64_t> values(kRows);
+  for (size_t i = 0; i < kRows; ++i) {
+    keys[i] = i * 7919 % kGroups;
+    values[i] = static_cast<int64_t>(i);
+  }
+  size_t init_calls = 0;
+  CountingSum aggregate;
+  aggregate.init_calls = &init_calls;
+  HashAggregator<uint64_t, CountingSum> aggregator(partition_bits, aggregate);
+  aggregator.add_batch(keys.data(), values.data(), kRows / 2);
+  aggregator.add_batch(keys.data() + kRows / 2, values.data() + kRows / 2,
+                       kRows - kRows / 2);
+  CHECK(aggregator.size() == kGroups);
+  CHECK(init_calls == kGroups);
+  std::vector<int64_t> expected(kGroups, 0);
+  for (size_t i = 0; i < kRows; ++i) {
+    expected[keys[i]] += values[i];
+  }
+  for (uint64_t key = 0; key < kGroups; ++key) {
+    CHECK(aggregator.at(key) == expected[key]);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestSumsAndInitCalls(0);
+  TestSumsAndInitCalls(4);
+  return 0;
+}
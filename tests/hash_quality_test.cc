@@ -0,0 +1,130 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "hash_functions.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr size_t kKeys = 1 << 16;
+constexpr size_t kSamples = 2000;
+
+// Keys that identity hashing spreads badly: consecutive integers, integers
+// sharing their low 16 bits, and strings sharing a long prefix.
+void TestBucketSpread() {
+  HashMap<uint64_t, int> sequential;
+  HashMap<uint64_t, int> strided;
+  HashMap<std::string, int> prefixed;
+  for (uint64_t i = 0; i < kKeys; ++i) {
+    sequential.insert({i, 0});
+    strided.insert({i << 16, 0});
+    prefixed.insert({"/usr/share/locale/" + std::to_string(i), 0});
+  }
+  for (const HashQualityReport &report :
+       {sequential.hash_quality(), strided.hash_quality(),
+        prefixed.hash_quality()}) {
+    CHECK(report.size == kKeys);
+    CHECK(report.normalized_chi_squared > 0.8);
+    CHECK(report.normalized_chi_squared < 1.2);
+    CHECK(report.empty_buckets < report.expected_empty_buckets * 1.05);
+  }
+}
+
+// A small map has no table; it reports the one built when it outgrows
+// SmallSize, so the numbers do not jump at that insert.
+void TestSmallMapReport() {
+  HashMap<int, int> map;
+  for (int key = 0; key < 8; ++key) {
+    map.insert({key, 0});
+  }
+  size_t buckets = map.bucket_count();
+  CHECK(buckets > 16);
+  CHECK(map.load_factor() == 8.0 / buckets);
+  CHECK(map.hash_quality().bucket_count == buckets);
+  size_t in_bucket = 0;
+  for (size_t n = 0; n < buckets; ++n) {
+    in_bucket += map.bucket_size(n);
+  }
+  CHECK(in_bucket == 8);
+  size_t bucket_of_zero = map.bucket(0);
+  map.insert({8, 0});
+  CHECK(map.bucket_count() == buckets);
+  CHECK(map.bucket(0) == bucket_of_zero);
+}
+
+// Flipping any one input bit should flip every output bit about half the
+// time. With kSamples keys per input bit the observed rate of a good hash
+// stays well inside [0.4, 0.6].
+template <class HashFn>
+void CheckAvalanche(size_t input_bits, HashFn hash_with_flip) {
+  std::vector<size_t> flips(64);
+  for (size_t bit = 0; bit < input_bits; ++bit) {
+    std::fill(flips.begin(), flips.end(), 0);
+    for (size_t sample = 0; sample < kSamples; ++sample) {
+      uint64_t diff = hash_with_flip(bit);
+      for (size_t out = 0; out < 64; ++out) {
+        flips[out] += (diff >> out) & 1;
+      }
+    }
+    for (size_t out = 0; out < 64; ++out) {
+      double rate = static_cast<double>(flips[out]) / kSamples;
+      CHECK(rate > 0.4 && rate < 0.6);
+    }
+  }
+}
+
+void TestIntegerAvalanche() {
+  std::mt19937_64 random(1);
+  IntegerHash<uint64_t> hash(random());
+  CheckAvalanche(64, [&](size_t bit) {
+    uint64_t key = random();
+    return hash(key) ^ hash(key ^ (uint64_t{1} << bit));
+  });
+}
+
+void TestStringAvalanche(size_t length) {
+  std::mt19937_64 random(length);
+  StringHash hash(random());
+  std::string key(length, '\0');
+  CheckAvalanche(std::min<size_t>(length * 8, 256), [&](size_t bit) {
+    for (char &c : key) {
+      c = static_cast<char>(random());
+    }
+    uint64_t before = hash(key);
+    key[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+    return before ^ hash(key);
+  });
+}
+
+void TestLongHashPathsAgree() {
+#ifdef HASH_FUNCTIONS_SSE2
+  std::mt19937_64 random(2);
+  std::vector<unsigned char> data(4096);
+  for (unsigned char &c : data) {
+    c = static_cast<unsigned char>(random());
+  }
+  for (size_t len = hash_internal::kLongInput; len <= data.size(); len += 7) {
+    uint64_t seed = random();
+    CHECK(hash_internal::LongHashSse2(data.data(), len, seed) ==
+          hash_internal::LongHashScalar(data.data(), len, seed));
+  }
+#endif
+}
+
+}  // namespace
+
+int main() {
+  TestBucketSpread();
+  TestSmallMapReport();
+  TestIntegerAvalanche();
+  for (size_t length : {4, 8, 16, 40, 100, 300}) {
+    TestStringAvalanche(length);
+  }
+  TestLongHashPathsAgree();
+  return 0;
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstddef>
+#include <functional>
+
+#include "check.h"
+#include "hopscotch_hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 20000;
+constexpr int kCrowded = 200;  // keys per home in the overflow tests
+
+// Negative keys share home 0 and the others home 1, so both neighbourhoods
+// fill up and the rest of the keys go to the overflow.
+struct TwoHomesHash {
+  size_t operator()(int key) const {
+    return key < 0 ? 0 : 1;
+  }
+};
+
+struct CountingEqual {
+  bool operator()(int lhs, int rhs) const {
+    ++*comparisons;
+    return lhs == rhs;
+  }
+
+  size_t *comparisons;
+};
+
+void TestInsertFindErase() {
+  HopscotchHashMap<int, int> map;
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(map.size() == kKeys);
+  CHECK(map.overflow_size() == 0);
+  for (int key = 0; key < kKeys; key += 2) {
+    map.erase(key);
+  }
+  map.erase(-1);
+  CHECK(map.size() == kKeys / 2);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.contains(key) == (key % 2 == 1));
+  }
+  HopscotchHashMap<int, int> copy(map);
+  for (int key = 1; key < kKeys; key += 2) {
+    copy[key] += 1;
+    CHECK(copy.at(key) == key + 1);
+    CHECK(map.at(key) == key);
+  }
+}
+
+void TestOverflow() {
+  size_t comparisons = 0;
+  HopscotchHashMap<int, int, TwoHomesHash, CountingEqual> map(
+      TwoHomesHash(), CountingEqual{&comparisons});
+  for (int key = 1; key <= kCrowded; ++key) {
+    map.insert({key, key});
+    map.insert({-key, -key});
+  }
+  CHECK(map.size() == 2 * kCrowded);
+  CHECK(map.overflow_size() > 0);
+  for (int key = 1; key <= kCrowded; ++key) {
+    CHECK(map.at(key) == key);
+    CHECK(map.at(-key) == -key);
+  }
+
+  // Once home 0 has no entries left, looking up one of its keys must not
+  // scan home 1's entries in the overflow.
+  for (int key = 1; key <= kCrowded; ++key) {
+    map.erase(-key);
+  }
+  CHECK(map.size() == kCrowded);
+  comparisons = 0;
+  CHECK(!map.contains(-1));
+  CHECK(comparisons == 0);
+  for (int key = 1; key <= kCrowded; ++key) {
+    CHECK(map.at(key) == key);
+  }
+  for (int key = 1; key <= kCrowded; ++key) {
+    map.erase(key);
+  }
+  CHECK(map.empty());
+  CHECK(map.overflow_size() == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestInsertFindErase();
+  TestOverflow();
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "colliding_hash.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 1000;
+
+template <class Hash>
+using TracedMap = HashMap<int, int, Hash, std::equal_to<int>, 8, NoStats,
+                          CallbackListener>;
+
+using Resize = std::pair<size_t, size_t>;
+
+// Every resize is bracketed by start and end with the same counts, and
+// each one starts from the table the previous one built; the first starts
+// from the small layout's 0.
+void TestResizeEvents() {
+  TracedMap<DefaultHash<int>> map;
+  std::vector<Resize> starts;
+  std::vector<Resize> ends;
+  map.listener().set_on_resize_start([&starts](size_t from, size_t to) {
+    starts.emplace_back(from, to);
+  });
+  map.listener().set_on_resize_end([&ends](size_t from, size_t to) {
+    ends.emplace_back(from, to);
+  });
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(!starts.empty());
+  CHECK(starts == ends);
+  CHECK(starts.front().first == 0);
+  for (size_t i = 1; i < starts.size(); ++i) {
+    CHECK(starts[i].first == starts[i - 1].second);
+    CHECK(starts[i].second > starts[i].first);
+  }
+  CHECK(starts.back().second == map.bucket_count());
+}
+
+// CollidingHash under its initial seed puts the keys in four chains.
+void TestLongProbeEvents() {
+  TracedMap<CollidingHash> map{CollidingHash()};
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  std::vector<Resize> probes;
+  map.listener().set_long_probe_threshold(8);
+  map.listener().set_on_long_probe([&probes](size_t walked, size_t bucket) {
+    probes.emplace_back(walked, bucket);
+  });
+  CHECK(map.find(kKeys - 1) != map.end());
+  CHECK(map.find(-kKeys) == map.end());
+  CHECK(map.find(1) != map.end());
+  CHECK(probes.size() >= 2);
+  for (const Resize &probe : probes) {
+    CHECK(probe.first > 8);
+    CHECK(probe.second < 4);
+  }
+
+  probes.clear();
+  map.listener().set_long_probe_threshold(2 * kKeys);
+  map.find(1);
+  CHECK(probes.empty());
+}
+
+#ifdef HASH_MAP_TRACE_USDT
+// Nothing is attached here; the probes must simply not get in the way.
+void TestUsdtListener() {
+  HashMap<int, int, DefaultHash<int>, std::equal_to<int>, 8, NoStats,
+          UsdtListener>
+      map;
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(map.listener().long_probe_threshold() == 8);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.at(key) == key);
+  }
+}
+#endif
+
+}  // namespace
+
+int main() {
+  TestResizeEvents();
+  TestLongProbeEvents();
+#ifdef HASH_MAP_TRACE_USDT
+  TestUsdtListener();
+#endif
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "lru_hash_map.h"
+
+namespace {
+
+constexpr size_t kCapacity = 16;
+
+// Recency list, most recently used first.
+class LruModel {
+ public:
+  // Returns the evicted key, or -1.
+  int Access(int key, bool insert) {
+    auto it = std::find(keys_.begin(), keys_.end(), key);
+    if (it != keys_.end()) {
+      keys_.splice(keys_.begin(), keys_, it);
+      return -1;
+    }
+    if (!insert) {
+      return -1;
+    }
+    int victim = -1;
+    if (keys_.size() == kCapacity) {
+      victim = keys_.back();
+      keys_.pop_back();
+    }
+    keys_.push_front(key);
+    return victim;
+  }
+
+  void Erase(int key) {
+    keys_.remove(key);
+  }
+
+  const std::list<int> &keys() const {
+    return keys_;
+  }
+
+ private:
+  std::list<int> keys_;
+};
+
+void TestMatchesModel() {
+  std::vector<int> evicted;
+  LruHashMap<int, int> cache(kCapacity, [&evicted](const int &key, int &) {
+    evicted.push_back(key);
+  });
+  LruModel model;
+  std::vector<int> expected;
+  std::mt19937 random(5);
+  std::uniform_int_distribution<int> keys(0, 3 * kCapacity);
+  std::uniform_int_distribution<int> ops(0, 9);
+  for (int step = 0; step < 20000; ++step) {
+    int key = keys(random);
+    int op = ops(random);
+    int victim = -1;
+    if (op == 0) {
+      cache.erase(key);
+      model.Erase(key);
+    } else if (op <= 3) {
+      int *value = cache.get(key);
+      CHECK((value != nullptr) == (cache.peek(key) != cache.end()));
+      victim = model.Access(key, false);
+    } else if (op <= 6) {
+      cache.insert({key, key});
+      victim = model.Access(key, true);
+    } else {
+      cache[key] = key;
+      victim = model.Access(key, true);
+    }
+    if (victim >= 0) {
+      expected.push_back(victim);
+    }
+    CHECK(evicted == expected);
+    std::vector<int> order;
+    for (const auto &entry : cache) {
+      CHECK(entry.first == entry.second);
+      order.push_back(entry.first);
+    }
+    CHECK(order == std::vector<int>(model.keys().begin(),
+                                    model.keys().end()));
+  }
+}
+
+// peek() leaves recency alone, so the peeked entry is still evicted first.
+void TestPeekKeepsRecency() {
+  LruHashMap<int, int> cache(2);
+  cache.insert({1, 1});
+  cache.insert({2, 2});
+  CHECK(cache.peek(1)->second == 1);
+  cache.insert({3, 3});
+  CHECK(cache.peek(1) == cache.end());
+  CHECK(*cache.get(2) == 2);
+  cache.insert({4, 4});
+  CHECK(cache.peek(3) == cache.end());
+  CHECK(cache.size() == 2);
+}
+
+void TestZeroCapacityRejected() {
+  bool thrown = false;
+  try {
+    LruHashMap<int, int> cache(0);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesModel();
+  TestPeekKeepsRecency();
+  TestZeroCapacityRejected();
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <string>
+#include <utility>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 100;  // well past SmallSize
+
+using Map = HashMap<int, std::string>;
+
+Map MakeMap(int first, int last) {
+  Map map;
+  for (int key = first; key < last; ++key) {
+    map.insert({key, std::to_string(key)});
+  }
+  return map;
+}
+
+void TestExtract() {
+  Map map = MakeMap(0, kKeys);
+  Map::node_type node = map.extract(7);
+  CHECK(node && !node.empty());
+  CHECK(node.key() == 7 && node.mapped() == "7");
+  CHECK(!map.contains(7));
+  CHECK(map.size() == kKeys - 1);
+
+  node = map.extract(map.find(8));
+  CHECK(node.key() == 8 && node.mapped() == "8");
+  CHECK(!map.contains(8));
+
+  node = map.extract(kKeys);
+  CHECK(node.empty() && !node);
+  for (int key = 9; key < kKeys; ++key) {
+    CHECK(map.at(key) == std::to_string(key));
+  }
+}
+
+// The entry moves with its node, so the inserted value keeps its address.
+void TestInsertNode() {
+  Map source = MakeMap(0, kKeys);
+  Map target;
+  for (int key = 0; key < kKeys; ++key) {
+    Map::node_type node = source.extract(key);
+    node.mapped() += "!";
+    const std::string *value = &node.mapped();
+    Map::insert_return_type result = target.insert(std::move(node));
+    CHECK(result.inserted && result.node.empty());
+    CHECK(result.position->first == key);
+    CHECK(&result.position->second == value);
+  }
+  CHECK(source.empty());
+  CHECK(target.size() == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(target.at(key) == std::to_string(key) + "!");
+  }
+}
+
+// A duplicate key hands the node back and leaves the map alone.
+void TestInsertDuplicateNode() {
+  Map map = MakeMap(0, kKeys);
+  Map other = MakeMap(0, 1);
+  other[0] = "other";
+  Map::insert_return_type result = map.insert(other.extract(0));
+  CHECK(!result.inserted);
+  CHECK(result.position == map.find(0));
+  CHECK(result.node.key() == 0 && result.node.mapped() == "other");
+  CHECK(map.at(0) == "0");
+  CHECK(map.size() == kKeys);
+
+  result = map.insert(Map::node_type());
+  CHECK(!result.inserted && result.node.empty());
+  CHECK(result.position == map.end());
+}
+
+// Keys already in the target stay behind in the source.
+void TestMerge() {
+  Map target = MakeMap(0, kKeys);
+  Map source = MakeMap(kKeys / 2, 2 * kKeys);
+  for (auto &entry : source) {
+    entry.second += "!";
+  }
+  target.merge(source);
+  CHECK(target.size() == 2 * kKeys);
+  CHECK(source.size() == kKeys / 2);
+  for (int key = 0; key < 2 * kKeys; ++key) {
+    std::string value = std::to_string(key);
+    CHECK(target.at(key) == (key < kKeys ? value : value + "!"));
+    CHECK(source.contains(key) == (key >= kKeys / 2 && key < kKeys));
+  }
+  target.merge(target);
+  CHECK(target.size() == 2 * kKeys);
+}
+
+}  // namespace
+
+int main() {
+  TestExtract();
+  TestInsertNode();
+  TestInsertDuplicateNode();
+  TestMerge();
+  return 0;
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 100000;  // enough for many bucket ranges
+constexpr size_t kThreadCounts[] = {1, 2, 4, 8};
+
+using Map = HashMap<int, int64_t>;
+
+Map MakeMap(int count) {
+  Map map;
+  for (int key = 0; key < count; ++key) {
+    map.insert({key, 3 * key});
+  }
+  return map;
+}
+
+// Keys in the order they are folded; not commutative, so it shows the order.
+std::vector<int> Append(std::vector<int> keys, const std::vector<int> &more) {
+  keys.insert(keys.end(), more.begin(), more.end());
+  return keys;
+}
+
+void CheckAgainstSerial(const Map &map) {
+  int64_t serial_sum = 0;
+  std::vector<int> serial_keys;
+  for (const auto &entry : map) {
+    serial_sum += entry.second;
+    serial_keys.push_back(entry.first);
+  }
+  std::sort(serial_keys.begin(), serial_keys.end());
+
+  std::vector<int> first_order;
+  for (size_t threads : kThreadCounts) {
+    std::atomic<int64_t> sum{0};
+    std::atomic<int64_t> visits{0};
+    map.parallel_for_each(
+        [&](const auto &entry) {
+          sum.fetch_add(entry.second, std::memory_order_relaxed);
+          visits.fetch_add(1, std::memory_order_relaxed);
+        },
+        threads);
+    CHECK(sum.load() == serial_sum);
+    CHECK(visits.load() == static_cast<int64_t>(map.size()));
+
+    int64_t reduced = map.parallel_reduce(
+        int64_t{0}, [](const auto &entry) { return entry.second; },
+        [](int64_t lhs, int64_t rhs) { return lhs + rhs; }, threads);
+    CHECK(reduced == serial_sum);
+
+    std::vector<int> order = map.parallel_reduce(
+        std::vector<int>(),
+        [](const auto &entry) { return std::vector<int>{entry.first}; },
+        Append, threads);
+    if (first_order.empty()) {
+      first_order = order;
+    }
+    CHECK(order == first_order);
+    std::sort(order.begin(), order.end());
+    CHECK(order == serial_keys);
+  }
+}
+
+void TestLargeMap() {
+  Map map = MakeMap(kKeys);
+  CheckAgainstSerial(map);
+  map.parallel_for_each([](auto &entry) { entry.second += 1; }, 4);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.at(key) == 3 * key + 1);
+  }
+}
+
+void TestSmallAndEmptyMaps() {
+  CheckAgainstSerial(MakeMap(5));
+  Map empty;
+  CHECK(empty.parallel_reduce(
+            int64_t{7}, [](const auto &entry) { return entry.second; },
+            [](int64_t lhs, int64_t rhs) { return lhs + rhs; }) == 7);
+}
+
+void TestExceptionPropagates() {
+  Map map = MakeMap(kKeys);
+  bool thrown = false;
+  try {
+    map.parallel_for_each(
+        [](const auto &entry) {
+          if (entry.first == kKeys / 2) {
+            throw std::runtime_error("stop");
+          }
+        },
+        4);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+// The pool threads are shared, so a nested call must not wait on tasks
+// queued behind its own caller.
+void TestNestedCalls() {
+  Map outer = MakeMap(kKeys);
+  Map inner = MakeMap(kKeys / 10);
+  std::atomic<int64_t> visits{0};
+  outer.parallel_for_each(
+      [&](const auto &entry) {
+        if (entry.first % 10000 == 0) {
+          inner.parallel_for_each(
+              [&](const auto &) {
+                visits.fetch_add(1, std::memory_order_relaxed);
+              },
+              4);
+        }
+      },
+      4);
+  CHECK(visits.load() == 10 * static_cast<int64_t>(inner.size()));
+}
+
+}  // namespace
+
+int main() {
+  TestLargeMap();
+  TestSmallAndEmptyMaps();
+  TestExceptionPropagates();
+  TestNestedCalls();
+  return 0;
+}
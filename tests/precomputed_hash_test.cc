@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "colliding_hash.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 5000;
+
+// Under its initial seed the hash builds chains far over the limit; inserts
+// with the caller's hashes must not reseed under them, or the second round
+// would insert every key again with its stale hash.
+void TestInsertWithHashKeepsHashesValid() {
+  HashMap<int, int, CollidingHash> map{CollidingHash()};
+  map.set_max_chain_length(8);
+  auto hasher = map.hash_function();
+  std::vector<size_t> hashes(kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    hashes[key] = hasher(key);
+  }
+  for (int round = 0; round < 2; ++round) {
+    for (int key = 0; key < kKeys; ++key) {
+      map.insert_with_hash({key, key}, hashes[key]);
+    }
+  }
+  CHECK(map.size() == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.find(key, hashes[key]) != map.end());
+    CHECK(map.find(key) != map.end());
+  }
+}
+
+void TestUpsertWithHashKeepsHashesValid() {
+  HashMap<int, int, CollidingHash> map{CollidingHash()};
+  map.set_max_chain_length(8);
+  auto hasher = map.hash_function();
+  for (int round = 0; round < 2; ++round) {
+    for (int key = 0; key < kKeys; ++key) {
+      map.upsert(key, hasher(key), [](int &count) { ++count; }, 1);
+    }
+  }
+  CHECK(map.size() == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.at(key) == 2);
+  }
+}
+
+// Plain inserts still reseed; lookups stay correct across it.
+void TestInsertStillReseeds() {
+  HashMap<int, int, CollidingHash> map{CollidingHash()};
+  map.set_max_chain_length(8);
+  int probe = 12345;
+  size_t before = map.hash_function()(probe);
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(map.hash_function()(probe) != before);
+  CHECK(map.size() == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map.at(key) == key);
+  }
+}
+
+// Maps built from one hasher keep its seed, so a hash computed once is
+// valid for all of them.
+void TestPassedHasherKeepsSeed() {
+  DefaultHash<int> hasher(42);
+  HashMap<int, int> first(hasher);
+  HashMap<int, int> second(hasher);
+  for (int key = 0; key < kKeys; ++key) {
+    size_t hash = hasher(key);
+    CHECK(first.hash_function()(key) == hash);
+    first.insert_with_hash({key, key}, hash);
+    second.insert_with_hash({key, -key}, hash);
+  }
+  for (int key = 0; key < kKeys; ++key) {
+    size_t hash = hasher(key);
+    CHECK(first.find(key, hash)->second == key);
+    CHECK(second.find(key, hash)->second == -key);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestInsertWithHashKeepsHashesValid();
+  TestUpsertWithHashKeepsHashesValid();
+  TestInsertStillReseeds();
+  TestPassedHasherKeepsSeed();
+  return 0;
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <stdexcept>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 10000;
+constexpr double kMinLoad = 0.125;
+
+using Map = HashMap<int, int>;
+
+Map MakeMap(int count) {
+  Map map;
+  for (int key = 0; key < count; ++key) {
+    map.insert({key, key});
+  }
+  return map;
+}
+
+bool Rejected(Map *map, double factor) {
+  try {
+    map->set_min_load_factor(factor);
+  } catch (const std::invalid_argument &) {
+    return true;
+  }
+  return false;
+}
+
+// Shrinking must stay below half the growth threshold of 0.5.
+void TestFactorRange() {
+  Map map;
+  CHECK(map.min_load_factor() == 0);
+  CHECK(Rejected(&map, -0.1));
+  CHECK(Rejected(&map, 0.25));
+  CHECK(Rejected(&map, 1));
+  CHECK(map.min_load_factor() == 0);
+  CHECK(!Rejected(&map, 0.2));
+  CHECK(map.min_load_factor() == 0.2);
+  CHECK(!Rejected(&map, 0));
+}
+
+// Without a minimum load factor the table never shrinks on its own.
+void TestNoShrinkByDefault() {
+  Map map = MakeMap(kKeys);
+  size_t buckets = map.bucket_count();
+  for (int key = 0; key < kKeys - 10; ++key) {
+    map.erase(key);
+  }
+  CHECK(map.bucket_count() == buckets);
+}
+
+// Each erase keeps the load factor at or above the minimum, and a halved
+// table is still sparse enough not to grow on the next insert.
+void TestShrinkOnErase() {
+  Map map = MakeMap(kKeys);
+  map.set_min_load_factor(kMinLoad);
+  size_t full = map.bucket_count();
+  for (int key = 0; key < kKeys - 10; ++key) {
+    map.erase(key);
+    CHECK(map.load_factor() >= kMinLoad);
+    CHECK(map.load_factor() < 0.5);
+  }
+  CHECK(map.bucket_count() < full / 64);
+  for (int key = kKeys - 10; key < kKeys; ++key) {
+    CHECK(map.at(key) == key);
+  }
+
+  size_t buckets = map.bucket_count();
+  map.insert({0, 0});
+  CHECK(map.bucket_count() == buckets);
+}
+
+// Raising the factor shrinks an already sparse map at once; extract and
+// erase_if shrink too.
+void TestShrinkOnOtherRemovals() {
+  Map map = MakeMap(kKeys);
+  map.erase_if([](const auto &entry) { return entry.first >= 100; });
+  size_t buckets = map.bucket_count();
+  map.set_min_load_factor(kMinLoad);
+  CHECK(map.bucket_count() < buckets);
+  CHECK(map.load_factor() >= kMinLoad);
+
+  map = MakeMap(kKeys);
+  map.set_min_load_factor(kMinLoad);
+  map.erase_if([](const auto &entry) { return entry.first >= 100; });
+  CHECK(map.load_factor() >= kMinLoad);
+  for (int key = 50; key < 100; ++key) {
+    map.extract(key);
+    CHECK(map.load_factor() >= kMinLoad);
+  }
+  CHECK(map.size() == 50);
+}
+
+void TestShrinkToFit() {
+  Map map = MakeMap(kKeys);
+  map.reserve(10 * kKeys);
+  for (int key = 100; key < kKeys; ++key) {
+    map.erase(key);
+  }
+  map.shrink_to_fit();
+  Map fresh = MakeMap(100);
+  fresh.shrink_to_fit();
+  CHECK(map.bucket_count() == fresh.bucket_count());
+  CHECK(map.load_factor() < 0.5);
+  for (int key = 0; key < 100; ++key) {
+    CHECK(map.at(key) == key);
+  }
+}
+
+// clear(true) keeps the table for refilling; clear() releases it.
+void TestClear() {
+  Map map = MakeMap(kKeys);
+  size_t buckets = map.bucket_count();
+  map.clear(true);
+  CHECK(map.empty());
+  CHECK(map.bucket_count() == buckets);
+  CHECK(map.memory_usage().bucket_array_bytes != 0);
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  CHECK(map.bucket_count() == buckets);
+
+  map.clear();
+  CHECK(map.empty());
+  CHECK(map.memory_usage().bucket_array_bytes == 0);
+  CHECK(map.bucket_count() < buckets);
+}
+
+}  // namespace
+
+int main() {
+  TestFactorRange();
+  TestNoShrinkByDefault();
+  TestShrinkOnErase();
+  TestShrinkOnOtherRemovals();
+  TestShrinkToFit();
+  TestClear();
+  return 0;
+}
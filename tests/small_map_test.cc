@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <functional>
+#include <string>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kSmall = 8;  // HashMap's default SmallSize
+
+bool HasTable(const HashMap<int, std::string> &map) {
+  return map.memory_usage().bucket_array_bytes != 0;
+}
+
+void CheckEntries(const HashMap<int, std::string> &map, int count) {
+  CHECK(map.size() == static_cast<size_t>(count));
+  for (int key = 0; key < count; ++key) {
+    CHECK(map.at(key) == std::to_string(key));
+  }
+  CHECK(map.find(count) == map.end());
+}
+
+// Up to SmallSize entries live in the element list alone; the next insert
+// builds the table.
+void TestTableBuiltPastSmallSize() {
+  HashMap<int, std::string> map;
+  for (int key = 0; key < kSmall; ++key) {
+    map[key] = std::to_string(key);
+    CHECK(!HasTable(map));
+  }
+  CheckEntries(map, kSmall);
+  map.insert({kSmall, std::to_string(kSmall)});
+  CHECK(HasTable(map));
+  CheckEntries(map, kSmall + 1);
+}
+
+void TestOperationsWhileSmall() {
+  HashMap<int, std::string> map;
+  for (int key = 0; key < kSmall; ++key) {
+    map.insert({key, std::to_string(key)});
+  }
+  map.erase(3);
+  CHECK(!map.contains(3));
+  map.compute(3, [](std::string &value) { value = "3"; });
+  CHECK(map.upsert(
+      42, [](std::string &) {}, [] { return std::string("x"); }));
+  CHECK(map.size() == kSmall + 1);
+  CHECK(HasTable(map));
+  map.erase(42);
+  CHECK(HasTable(map));  // only shrink_to_fit() or clear() drop it
+  CheckEntries(map, kSmall);
+  size_t hash = map.hash_function()(5);
+  CHECK(map.find(5, hash) != map.end());
+}
+
+// shrink_to_fit() and clear() return to the small layout; clear(true)
+// keeps the table.
+void TestBackToSmall() {
+  HashMap<int, std::string> map;
+  for (int key = 0; key < 100; ++key) {
+    map.insert({key, std::to_string(key)});
+  }
+  for (int key = 3; key < 100; ++key) {
+    map.erase(key);
+  }
+  CHECK(HasTable(map));
+  map.shrink_to_fit();
+  CHECK(!HasTable(map));
+  CheckEntries(map, 3);
+
+  for (int key = 3; key < 100; ++key) {
+    map.insert({key, std::to_string(key)});
+  }
+  map.clear(true);
+  CHECK(map.empty() && HasTable(map));
+  map.clear();
+  CHECK(!HasTable(map));
+  map.insert({0, "0"});
+  CheckEntries(map, 1);
+}
+
+void TestZeroSmallSize() {
+  HashMap<int, int, DefaultHash<int>, std::equal_to<int>, 0> map;
+  map.insert({1, 1});
+  CHECK(map.memory_usage().bucket_array_bytes != 0);
+  CHECK(map.at(1) == 1);
+}
+
+}  // namespace
+
+int main() {
+  TestTableBuiltPastSmallSize();
+  TestOperationsWhileSmall();
+  TestBackToSmall();
+  TestZeroSmallSize();
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "check.h"
+#include "hash_map.h"
+
+namespace {
+
+using Map = HashMap<int, int, DefaultHash<int>, std::equal_to<int>, 8,
+                    CollectStats>;
+
+constexpr int kKeys = 1000;
+
+size_t LongestBucket(const Map &map) {
+  size_t longest = 0;
+  for (size_t n = 0; n < map.bucket_count(); ++n) {
+    longest = std::max(longest, map.bucket_size(n));
+  }
+  return longest;
+}
+
+bool Contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+// A small map has no table; its longest bucket is the one its entries will
+// share once the table is built, not the whole map.
+void TestSmallMap() {
+  Map map;
+  for (int key = 0; key < 3; ++key) {
+    map.insert({key, key});
+  }
+  HashMapStats stats = map.stats();
+  CHECK(stats.inserts == 3);
+  CHECK(stats.max_bucket_length == LongestBucket(map));
+  CHECK(stats.max_bucket_length + 1 == map.bucket_histogram().size());
+}
+
+void TestCounters() {
+  Map map;
+  for (int key = 0; key < kKeys; ++key) {
+    map.insert({key, key});
+  }
+  for (int key = 0; key < kKeys / 10; ++key) {
+    map.erase(key);
+  }
+  HashMapStats stats = map.stats();
+  CHECK(stats.inserts == kKeys);
+  CHECK(stats.erases == kKeys / 10);
+  CHECK(stats.resizes > 0);
+
+  map.reset_stats();
+  for (int key = 0; key < 2 * kKeys; ++key) {
+    map.find(key);
+  }
+  stats = map.stats();
+  CHECK(stats.finds == 2 * kKeys);
+  CHECK(stats.hits == kKeys - kKeys / 10);
+  CHECK(stats.misses == stats.finds - stats.hits);
+  uint64_t probed = 0;
+  for (uint64_t count : stats.probe_histogram) {
+    probed += count;
+  }
+  CHECK(probed == stats.finds);
+  CHECK(stats.max_bucket_length == LongestBucket(map));
+  CHECK(stats.memory_bytes == map.memory_usage().total_bytes);
+
+  std::string json = stats.ToJson();
+  CHECK(json.front() == '{' && json.back() == '}');
+  CHECK(Contains(json, "\"finds\":" + std::to_string(stats.finds)));
+  CHECK(Contains(json, "\"hits\":" + std::to_string(stats.hits)));
+  CHECK(Contains(json, "\"max_bucket_length\":" +
+                           std::to_string(stats.max_bucket_length)));
+  CHECK(Contains(json, "\"probe_histogram\":["));
+  CHECK(Contains(stats.ToText(), "finds: " + std::to_string(stats.finds)));
+}
+
+}  // namespace
+
+int main() {
+  TestSmallMap();
+  TestCounters();
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Elisaveta Oreshonok <eaoreshonok@edu.hse.ru>
+#include <string>
+
+#include "check.h"
+#include "concurrent_cuckoo_hash_map.h"
+#include "hash_map.h"
+
+namespace {
+
+constexpr int kKeys = 1000;
+
+// init runs once per new key; every later upsert of the key only updates.
+template <class Map, class Upsert>
+void CheckInitOnlyOnMiss(Map *map, Upsert upsert) {
+  int init_calls = 0;
+  for (int round = 0; round < 3; ++round) {
+    for (int key = 0; key < kKeys; ++key) {
+      bool inserted = upsert(map, key, [&init_calls, key] {
+        ++init_calls;
+        return std::string(40, static_cast<char>('a' + key % 26));
+      });
+      CHECK(inserted == (round == 0));
+    }
+  }
+  CHECK(init_calls == kKeys);
+  for (int key = 0; key < kKeys; ++key) {
+    CHECK(map->at(key) ==
+          std::string(40, static_cast<char>('a' + key % 26)) + "!!");
+  }
+}
+
+auto Append = [](std::string &value) { value += "!"; };
+
+void TestHashMap() {
+  HashMap<int, std::string> map;
+  CheckInitOnlyOnMiss(&map, [](auto *target, int key, auto init) {
+    return target->upsert(key, Append, init);
+  });
+
+  HashMap<int, std::string> hashed;
+  CheckInitOnlyOnMiss(&hashed, [](auto *target, int key, auto init) {
+    return target->upsert(key, target->hash_function()(key), Append, init);
+  });
+
+  // The value overload copies a ready-made value.
+  HashMap<int, std::string> by_value;
+  std::string init = "x";
+  CHECK(by_value.upsert(1, Append, init));
+  CHECK(!by_value.upsert(1, Append, init));
+  CHECK(by_value.at(1) == "x!");
+}
+
+void TestConcurrentCuckooHashMap() {
+  ConcurrentCuckooHashMap<int, std::string> map;
+  CheckInitOnlyOnMiss(&map, [](auto *target, int key, auto init) {
+    return target->upsert(key, Append, init);
+  });
+
+  ConcurrentCuckooHashMap<int, std::string> by_value;
+  CHECK(by_value.upsert(1, Append, std::string("x")));
+  CHECK(!by_value.upsert(1, Append, std::string("x")));
+  CHECK(by_value.at(1) == "x!");
+}
+
+}  // namespace
+
+int main() {
+  TestHashMap();
+  TestConcurrentCuckooHashMap();
+  return 0;
+}